@@ -0,0 +1,89 @@
+// Scene switch cost with and without the script cache over a generated module, run with make bench-script
+#include <stdio.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <raylib.h>
+#include "../build/lua/lua.h"
+#include "../build/lua/lauxlib.h"
+#include "../src/scriptcache.h"
+
+#define SCENES 500
+#define LINES 60
+#define SCENE_DIR "build/bench_scenes"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void scenePath(char *out, size_t size, int scene) {
+    snprintf(out, size, "%s/scene_%03d.lua", SCENE_DIR, scene);
+}
+
+// Roughly what a hand written scene looks like, dialog with a branch at the end
+static void writeScenes(void) {
+    mkdir(SCENE_DIR, 0755);
+    for (int scene = 0; scene < SCENES; scene++) {
+        char path[256];
+        scenePath(path, sizeof(path), scene);
+        FILE *out = fopen(path, "w");
+        if (!out) continue;
+        fprintf(out, "Narrator = { name = \"Narrator\", color = { r = 200, g = 200, b = 255, a = 255 } }\n");
+        fprintf(out, "load_background(\"bg_%d.png\")\nplay_music(\"track_%d.mp3\")\n", scene % 7, scene % 3);
+        for (int line = 0; line < LINES; line++) {
+            if (line % 10 == 0) fprintf(out, "load_sprite(\"fairy.png\", %d, 150, \"Fairy\")\n", 100 + line);
+            fprintf(out, "show_text(Narrator, \"Scene %d, line %d: the path bends towards the river and the lanterns flicker.\")\n", scene, line);
+            if (line % 15 == 14) fprintf(out, "if last_scene == \"scene_%03d.lua\" then visited = (visited or 0) + 1 end\n", line);
+        }
+        fprintf(out, "set_choices({\n    { text = \"Left\", scene = \"scene_%03d.lua\" },\n    { text = \"Right\", scene = \"scene_%03d.lua\" }\n})\n",
+                (scene + 1) % SCENES, (scene + 7) % SCENES);
+        fclose(out);
+    }
+}
+
+typedef int (*LoadFn)(lua_State *L, const char *path);
+
+// Average microseconds to get a scene's main function onto a fresh thread, as loadScene does
+static double run(lua_State *L, LoadFn load) {
+    double start = now();
+    for (int scene = 0; scene < SCENES; scene++) {
+        char path[256];
+        scenePath(path, sizeof(path), scene);
+        lua_State *thread = lua_newthread(L);
+        if (load(thread, path) != LUA_OK) fprintf(stderr, "%s\n", lua_tostring(thread, -1));
+        lua_pop(L, 1);
+    }
+    double elapsed = now() - start;
+    lua_gc(L, LUA_GCCOLLECT);
+    return elapsed / SCENES * 1e6;
+}
+
+static int loadSource(lua_State *L, const char *path) {
+    return luaL_loadfile(L, path);
+}
+
+int main(void) {
+    SetTraceLogLevel(LOG_WARNING);
+    writeScenes();
+    for (int scene = 0; scene < SCENES; scene++) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/scene_%03d.lua%s", SCENE_DIR, scene, SCRIPT_CACHE_SUFFIX);
+        remove(path);
+    }
+
+    lua_State *L = luaL_newstate();
+    double source = run(L, loadSource);
+    double compile = run(L, scriptCacheLoad);
+    scriptCacheClear(L);
+    double disk = run(L, scriptCacheLoad);
+    double memory = run(L, scriptCacheLoad);
+    lua_close(L);
+
+    printf("%d scenes of %d lines\n", SCENES, LINES);
+    printf("luaL_loadfile           %8.2f us\n", source);
+    printf("cache, compile + write  %8.2f us\n", compile);
+    printf("cache, bytecode on disk %8.2f us (%.1fx)\n", disk, source / disk);
+    printf("cache, loaded chunk     %8.2f us (%.1fx)\n", memory, source / memory);
+    return 0;
+}
@@ -0,0 +1,72 @@
+// Compares DrawTextBoxed against the cached layout on a full dialog box, run with make bench-text
+#include <stdio.h>
+#include <raylib.h>
+#include "../src/boundedtext.h"
+#include "../src/textlayout.h"
+
+#define ITERATIONS 2000
+
+static const char *gText =
+    "The fairy hovered above the path for a long moment, wings humming, before she spoke again. "
+    "\"You came all this way for a lantern? There are easier lights to find in the valley, and most of them "
+    "do not ask for anything in return.\" She circled once, slowly, as if weighing something.\n"
+    "\"Still, a promise is a promise. Follow the stones that glow and do not step off them, whatever you hear "
+    "calling from the trees. Some of those voices will sound like people you know.\"";
+
+typedef void (*BenchFn)(Font font, Rectangle box, int iteration);
+
+static void benchBoxed(Font font, Rectangle box, int iteration) {
+    DrawTextBoxed(font, gText, box, 20, 2, true, WHITE);
+}
+
+static void benchCached(Font font, Rectangle box, int iteration) {
+    const TextLayout *layout = textLayoutGet(font, gText, box, 20, 2, true);
+    textLayoutDraw(layout, (Vector2){ box.x, box.y }, -1, WHITE);
+}
+
+static void benchCold(Font font, Rectangle box, int iteration) {
+    textLayoutClear();
+    benchCached(font, box, iteration);
+}
+
+static void benchReveal(Font font, Rectangle box, int iteration) {
+    const TextLayout *layout = textLayoutGet(font, gText, box, 20, 2, true);
+    textLayoutDraw(layout, (Vector2){ box.x, box.y }, iteration % (textLayoutGlyphs(layout) + 1), WHITE);
+}
+
+// Time only the text calls, flushing the batch is left to EndDrawing outside the measurement
+static double run(BenchFn fn, Font font, Rectangle box) {
+    double total = 0;
+    for (int i = 0; i < ITERATIONS; i++) {
+        BeginDrawing();
+        ClearBackground(BLACK);
+        double start = GetTime();
+        fn(font, box, i);
+        total += GetTime() - start;
+        EndDrawing();
+    }
+    return total / ITERATIONS * 1e6;
+}
+
+int main(void) {
+    SetTraceLogLevel(LOG_WARNING);
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    InitWindow(1280, 720, "text layout bench");
+    Font font = GetFontDefault();
+    Rectangle box = { 40, 480, 1200, 220 };
+
+    double boxed = run(benchBoxed, font, box);
+    double cached = run(benchCached, font, box);
+    double cold = run(benchCold, font, box);
+    double reveal = run(benchReveal, font, box);
+    const TextLayout *layout = textLayoutGet(font, gText, box, 20, 2, true);
+    printf("%d glyphs, %d iterations\n", textLayoutGlyphs(layout), ITERATIONS);
+    printf("DrawTextBoxed      %8.2f us\n", boxed);
+    printf("layout, cached     %8.2f us (%.1fx)\n", cached, boxed / cached);
+    printf("layout, rebuilt    %8.2f us (%.1fx)\n", cold, boxed / cold);
+    printf("layout, reveal     %8.2f us\n", reveal);
+
+    textLayoutClear();
+    CloseWindow();
+    return 0;
+}
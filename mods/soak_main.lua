@@ -0,0 +1,5 @@
+module_init("test")
+set_choices({
+    { text = "Start soak", scene = "soak.lua" },
+    { text = "Quit", scene = "quit.lua" }
+})
@@ -0,0 +1,4 @@
+module_init("test")
+set_choices({
+    { text = "Stall the render loop", scene = "stall.lua" }
+})
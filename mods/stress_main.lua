@@ -0,0 +1,7 @@
+module_init("test")
+set_cache_budget(1)
+set_choices({
+    { text = "Churn the asset cache", scene = "stress.lua" },
+    { text = "Stall the render loop", scene = "stall.lua" },
+    { text = "Quit", scene = "quit.lua" }
+})
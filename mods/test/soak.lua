@@ -0,0 +1,34 @@
+-- Walked by make soak: every visit is a transition through set_choices or pop_state,
+-- the engine checks that neither the Lua heap nor the main thread's stack grows over the run.
+Soak = { name = "Soak", color = { r = 120, g = 200, b = 255, a = 255 } }
+local backgrounds = { "bg_forest.png", "bg_dark_forest.jpg" }
+local tracks = { "adventure.mp3", "a.mp3" }
+soak_visits = (soak_visits or 0) + 1
+
+load_background(backgrounds[soak_visits % 2 + 1])
+if soak_visits % 2 == 0 then
+    load_sprite("fairy.png", 200, 150, "Fairy")
+else
+    unload_sprite("Fairy")
+end
+if soak_visits % 50 == 0 then play_music(tracks[soak_visits // 50 % 2 + 1]) end
+
+local lines = {}
+for i = 1, 3 do
+    lines[i] = string.format("Visit %d, line %d", soak_visits, i)
+    show_text(Soak, lines[i])
+end
+
+-- Restarts the scene from inside its own coroutine, which then has to be retired once it returns
+if soak_visits % 10 == 0 then
+    pop_state()
+    return
+end
+
+local stats = script_stats()
+show_text(Soak, string.format("%d threads created, %d reused, main stack %d",
+    stats.threads_created, stats.threads_reused, stats.main_stack))
+set_choices({
+    { text = "Again", scene = "soak.lua" },
+    { text = "Again, the other way", scene = "soak.lua" }
+})
@@ -0,0 +1,26 @@
+-- Freezes the render loop for 250 ms at a time while tracks change underneath it,
+-- the music thread has to keep every stream fed regardless.
+-- Run by make stall on the real audio backend, the null one headless builds use never underruns.
+Stall = { name = "Stall", color = { r = 255, g = 120, b = 120, a = 255 } }
+local tracks = { "adventure.mp3", "a.mp3" }
+
+local function stall(seconds)
+    local start = os.clock()
+    while os.clock() - start < seconds do end
+end
+
+local before = audio_stats()
+for i = 1, 20 do
+    if i % 5 == 0 then play_music(tracks[i // 5 % 2 + 1]) end
+    stall(0.25)
+end
+
+local stats = audio_stats()
+assert(stats.late == before.late, string.format("music underran %d times during stalls", stats.late - before.late))
+assert(stats.streams <= 2, "music streams leaked: " .. stats.streams)
+show_text(Stall, string.format("20 stalls of 250 ms: %d refills, longest gap %.1f ms, %d late",
+    stats.refills, stats.max_gap_ms, stats.late))
+-- A single choice, so make stall keeps stalling whichever choice it takes
+set_choices({
+    { text = "Stall again", scene = "stall.lua" }
+})
@@ -0,0 +1,38 @@
+-- Every press of space runs another round of load/unload churn followed by a rollback,
+-- with a cache budget far smaller than what is on screen so eviction runs every frame.
+-- Run without input by make stress, which fails on any assert below.
+Stress = { name = "Stress", color = { r = 255, g = 200, b = 0, a = 255 } }
+local backgrounds = { "bg_forest.png", "bg_dark_forest.jpg" }
+local tracks = { "adventure.mp3", "a.mp3" }
+stress_rounds = (stress_rounds or 0) + 1
+
+for i = 1, 1000 do
+    load_background(backgrounds[i % 2 + 1])
+    load_sprite("fairy.png", 200, 150, "Fairy")
+    if i % 3 == 0 then load_sprite("fairy.png", 400, 150, "Fairy2") end
+    unload_sprite("Fairy")
+    unload_sprite("Fairy2")
+end
+play_music(tracks[stress_rounds % 2 + 1])
+
+local stats = cache_stats()
+-- Releases land at frame end, so both backgrounds and the sprite may be held
+assert(stats.live <= 3, "asset handles leaked: " .. stats.live)
+-- Switching tracks every round must never leave more than the incoming and outgoing stream open
+assert(stats.music_streams <= 2, "music streams leaked: " .. stats.music_streams)
+show_text(Stress, string.format("Round %d: %d hits, %d misses, %d evictions, %d KiB of textures resident",
+    stress_rounds, stats.hits, stats.misses, stats.evictions, stats.vram_used // 1024))
+-- Going back to the line above replays this scene up to it, the increment at the top must not run again
+assert(stress_shown == nil or stress_shown == stress_rounds,
+    string.format("rewind moved the round from %d to %d", stress_shown or 0, stress_rounds))
+stress_shown = stress_rounds
+show_text(Stress, "Press back and then space, the round must stay the same.")
+stress_shown = nil
+
+if stress_rounds % 100 ~= 0 then
+    pop_state()
+    return
+end
+set_choices({
+    { text = "Another 100 rounds", scene = "stress.lua" }
+})
@@ -0,0 +1,299 @@
+#include <stdlib.h>
+#include <string.h>
+#include <raylib.h>
+#include "../external/cc.h"
+#include "assetcache.h"
+
+// Only unreferenced, loaded entries sit on the recency list, so eviction is always O(1)
+struct CacheEntry {
+    struct CacheEntry *prev; // towards most recently used
+    struct CacheEntry *next; // towards least recently used
+    AssetKind kind;
+    size_t bytes;
+    int refs;
+    bool loading;
+    bool listed;
+    bool dropped;
+    bool stale;          // its file changed, the next fill replaces it whatever it was sized for
+    int sourceWidth;     // layout size, the texture may be resampled smaller
+    int sourceHeight;
+    int target;          // screen height the texture was sized for
+    Texture2D texture;   // standalone textures only
+    AtlasRegion *region; // packed sprites
+    char key[];
+};
+
+typedef struct {
+    AssetHandle *head;
+    AssetHandle *tail;
+    size_t used;
+    size_t budget;
+} CachePool;
+
+// One map per kind since the same image may be used as a background and a sprite
+static map(char *, AssetHandle *) gEntries[ASSET_KIND_COUNT];
+static CachePool gPool;
+static vec(AssetHandle *) gReleases;
+static vec(AssetHandle *) gDropped; // out of the maps but still referenced
+static AssetCacheStats gStats;
+
+static size_t textureBytes(Texture2D texture) {
+    size_t bytes = GetPixelDataSize(texture.width, texture.height, texture.format);
+    if (texture.mipmaps > 1) bytes += bytes / 3;
+    return bytes;
+}
+
+static void unlinkEntry(AssetHandle *entry) {
+    if (!entry->listed) return;
+    if (entry->prev) entry->prev->next = entry->next;
+    else gPool.head = entry->next;
+    if (entry->next) entry->next->prev = entry->prev;
+    else gPool.tail = entry->prev;
+    entry->prev = entry->next = NULL;
+    entry->listed = false;
+}
+
+static void pushFront(AssetHandle *entry) {
+    entry->prev = NULL;
+    entry->next = gPool.head;
+    if (gPool.head) gPool.head->prev = entry;
+    gPool.head = entry;
+    if (!gPool.tail) gPool.tail = entry;
+    entry->listed = true;
+}
+
+static void unloadTexture(AssetHandle *entry) {
+    if (entry->region) atlasFree(entry->region);
+    else if (entry->texture.id != 0) UnloadTexture(entry->texture);
+    entry->region = NULL;
+    entry->texture = (Texture2D){ 0 };
+}
+
+static void freeEntry(AssetHandle *entry) {
+    unlinkEntry(entry);
+    gPool.used -= entry->bytes;
+    if (!entry->dropped) {
+        erase(&gEntries[entry->kind], entry->key);
+    } else {
+        for (size_t i = 0; i < size(&gDropped); i++) {
+            if (*get(&gDropped, i) == entry) {
+                erase(&gDropped, i);
+                break;
+            }
+        }
+    }
+    unloadTexture(entry);
+    free(entry);
+}
+
+static AssetHandle *lookup(AssetKind kind, const char *path) {
+    AssetHandle **entry = get(&gEntries[kind], (char *)path);
+    return entry ? *entry : NULL;
+}
+
+static AssetHandle *addEntry(AssetKind kind, const char *path) {
+    size_t len = strlen(path) + 1;
+    AssetHandle *entry = calloc(1, sizeof(AssetHandle) + len);
+    if (!entry) return NULL;
+    memcpy(entry->key, path, len);
+    entry->kind = kind;
+    if (!insert(&gEntries[kind], entry->key, entry)) {
+        free(entry);
+        return NULL;
+    }
+    return entry;
+}
+
+static void setBytes(AssetHandle *entry, size_t bytes) {
+    gPool.used = gPool.used - entry->bytes + bytes;
+    entry->bytes = bytes;
+}
+
+void assetCacheInit(size_t vramBudget) {
+    for (int i = 0; i < ASSET_KIND_COUNT; i++)
+        init(&gEntries[i]);
+    init(&gReleases);
+    init(&gDropped);
+    memset(&gPool, 0, sizeof(gPool));
+    memset(&gStats, 0, sizeof(gStats));
+    assetCacheSetBudget(vramBudget);
+}
+
+void assetCacheSetBudget(size_t vramBudget) {
+    gPool.budget = vramBudget;
+}
+
+void assetCacheClear(void) {
+    clear(&gReleases);
+    for (int i = 0; i < ASSET_KIND_COUNT; i++) {
+        for_each(&gEntries[i], entry) {
+            (*entry)->dropped = true;
+            push(&gDropped, *entry);
+        }
+        cleanup(&gEntries[i]);
+    }
+    while (size(&gDropped) > 0)
+        freeEntry(*last(&gDropped));
+    gStats.live = 0;
+}
+
+AssetHandle *assetCacheAcquire(AssetKind kind, const char *path) {
+    AssetHandle *entry = lookup(kind, path);
+    if (!entry) {
+        gStats.misses++;
+        return NULL;
+    }
+    gStats.hits++;
+    return assetRetain(entry);
+}
+
+bool assetCacheHas(AssetKind kind, const char *path) {
+    return lookup(kind, path) != NULL;
+}
+
+AssetHandle *assetCacheReserve(AssetKind kind, const char *path) {
+    AssetHandle *entry = lookup(kind, path);
+    if (entry) return entry;
+    entry = addEntry(kind, path);
+    if (entry) entry->loading = true;
+    return entry;
+}
+
+AssetHandle *assetCacheFill(AssetKind kind, const char *path, AssetImage decoded) {
+    Image image = decoded.image;
+    AssetHandle *entry = lookup(kind, path);
+    if (entry && !entry->loading && (!image.data || (!entry->stale && entry->target == decoded.target))) {
+        UnloadImage(image);
+        return entry;
+    }
+    if (!entry) entry = addEntry(kind, path);
+    if (!entry) {
+        UnloadImage(image);
+        return NULL;
+    }
+    // Resized for a new screen, holders see the new texture on their next draw
+    if (!entry->loading) unloadTexture(entry);
+    entry->loading = false;
+    entry->stale = false;
+    entry->sourceWidth = decoded.sourceWidth;
+    entry->sourceHeight = decoded.sourceHeight;
+    entry->target = decoded.target;
+    if (image.data && kind == ASSET_SPRITE) entry->region = atlasAdd(image);
+    if (image.data && !entry->region) {
+        entry->texture = LoadTextureFromImage(image);
+        // A sprite the atlas could not take is mipmapped when it is drawn smaller than it is, the worst were already resampled
+        if (kind == ASSET_SPRITE && entry->texture.id != 0 && entry->texture.height > decoded.target * SPRITE_SCREEN_HEIGHT) {
+            GenTextureMipmaps(&entry->texture);
+            SetTextureFilter(entry->texture, TEXTURE_FILTER_TRILINEAR);
+        }
+    }
+    UnloadImage(image);
+    if (!entry->region && entry->texture.id == 0) {
+        // Holders keep an empty texture, the next load of this path retries
+        assetCacheDrop(kind, path);
+        return NULL;
+    }
+    setBytes(entry, entry->region ? atlasBytes(entry->region) : textureBytes(entry->texture));
+    if (entry->refs == 0) {
+        unlinkEntry(entry);
+        pushFront(entry);
+    }
+    return entry;
+}
+
+bool assetCacheDrop(AssetKind kind, const char *path) {
+    AssetHandle *entry = lookup(kind, path);
+    if (!entry) return false;
+    erase(&gEntries[kind], entry->key);
+    entry->dropped = true;
+    push(&gDropped, entry);
+    if (entry->refs == 0) freeEntry(entry);
+    else unlinkEntry(entry);
+    return true;
+}
+
+bool assetCacheReload(AssetKind kind, const char *path) {
+    AssetHandle *entry = lookup(kind, path);
+    if (!entry) return false;
+    if (entry->refs == 0 && !entry->loading) {
+        assetCacheDrop(kind, path);
+        return false;
+    }
+    entry->stale = true;
+    return true;
+}
+
+AssetHandle *assetRetain(AssetHandle *handle) {
+    if (!handle) return NULL;
+    if (handle->refs++ == 0) {
+        gStats.live++;
+        unlinkEntry(handle);
+    }
+    return handle;
+}
+
+void assetRelease(AssetHandle *handle) {
+    if (handle) push(&gReleases, handle);
+}
+
+bool assetReady(const AssetHandle *handle) {
+    return handle && !handle->loading && (handle->region || handle->texture.id != 0);
+}
+
+Texture2D assetTexture(const AssetHandle *handle) {
+    if (!handle || handle->loading) return (Texture2D){ 0 };
+    return handle->region ? atlasTexture(handle->region) : handle->texture;
+}
+
+Rectangle assetSource(const AssetHandle *handle) {
+    if (!handle || handle->loading) return (Rectangle){ 0 };
+    if (handle->region) return atlasRect(handle->region);
+    return (Rectangle){ 0, 0, (float)handle->texture.width, (float)handle->texture.height };
+}
+
+Vector2 assetSize(const AssetHandle *handle) {
+    if (!handle || handle->loading) return (Vector2){ 0 };
+    return (Vector2){ (float)handle->sourceWidth, (float)handle->sourceHeight };
+}
+
+int assetTarget(const AssetHandle *handle) {
+    return handle ? handle->target : 0;
+}
+
+const char *assetPath(const AssetHandle *handle) {
+    return handle->key;
+}
+
+// Entries are charged their own texels, atlas pages are resident whole so the space their regions leave is charged too
+static size_t residentBytes(void) {
+    AtlasStats atlas = atlasGetStats();
+    return gPool.used + (atlas.pageBytes - atlas.liveBytes);
+}
+
+static void trimPool(void) {
+    while (residentBytes() > gPool.budget && gPool.tail) {
+        AssetHandle *victim = gPool.tail;
+        TraceLog(LOG_INFO, "Evicted %s (%zu bytes)", victim->key, victim->bytes);
+        freeEntry(victim);
+        gStats.evictions++;
+    }
+}
+
+void assetCacheEndFrame(void) {
+    for_each(&gReleases, it) {
+        AssetHandle *entry = *it;
+        if (--entry->refs > 0) continue;
+        gStats.live--;
+        if (entry->dropped) freeEntry(entry);
+        else if (!entry->loading) pushFront(entry);
+    }
+    clear(&gReleases);
+    trimPool();
+}
+
+AssetCacheStats assetCacheGetStats(void) {
+    AssetCacheStats stats = gStats;
+    stats.vramBudget = gPool.budget;
+    stats.vramUsed = residentBytes();
+    return stats;
+}
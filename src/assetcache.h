@@ -0,0 +1,62 @@
+#ifndef ASSETCACHE_H
+#define ASSETCACHE_H
+#include <stddef.h>
+#include <stdbool.h>
+#include <raylib.h>
+#include "assetloader.h"
+#include "atlas.h"
+
+#define CACHE_VRAM_BUDGET (256u << 20) // bytes of textures kept resident
+
+// A reference to a cached asset, the asset is never unloaded while a reference is held
+typedef struct CacheEntry AssetHandle;
+
+typedef struct {
+    size_t vramBudget;
+    size_t vramUsed;
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions;
+    int live; // entries with at least one reference
+} AssetCacheStats;
+
+extern void assetCacheInit(size_t vramBudget);
+extern void assetCacheSetBudget(size_t vramBudget);
+// Unload every cached asset, outstanding handles become invalid
+extern void assetCacheClear(void);
+
+// Take a reference to a cached asset, counts as a hit or miss, NULL when not cached
+extern AssetHandle *assetCacheAcquire(AssetKind kind, const char *path);
+// Presence check, including textures still being decoded, that touches neither counters nor recency
+extern bool assetCacheHas(AssetKind kind, const char *path);
+
+// Create an entry for a texture that is still being decoded, it is filled in by assetCacheFill
+extern AssetHandle *assetCacheReserve(AssetKind kind, const char *path);
+// Upload a decoded image and hand it to the cache, which takes the image, an empty one marks the load as failed
+// Sprites are packed into shared atlas pages, backgrounds and oversized sprites get a texture of their own
+// A loaded entry is replaced in place by an image sized for another target, its bytes are recounted
+extern AssetHandle *assetCacheFill(AssetKind kind, const char *path, AssetImage decoded);
+// Forget an entry, it is unloaded once its last reference is released
+extern bool assetCacheDrop(AssetKind kind, const char *path);
+// The file behind an entry changed, an unused entry is dropped and false returned
+// A held or loading one stays as it is until the next fill replaces it, true when that decode still has to be queued
+extern bool assetCacheReload(AssetKind kind, const char *path);
+
+extern AssetHandle *assetRetain(AssetHandle *handle);
+// References are dropped at the end of the frame so anything drawn this frame stays valid
+extern void assetRelease(AssetHandle *handle);
+extern bool assetReady(const AssetHandle *handle);
+// The texture to draw from, an atlas page for packed sprites, empty while loading
+extern Texture2D assetTexture(const AssetHandle *handle);
+// The part of assetTexture() that holds the asset
+extern Rectangle assetSource(const AssetHandle *handle);
+// Size of the source image, positions are given in its pixels whatever size the texture was resampled to
+extern Vector2 assetSize(const AssetHandle *handle);
+// Screen height the texture was sized for
+extern int assetTarget(const AssetHandle *handle);
+extern const char *assetPath(const AssetHandle *handle);
+
+// Apply deferred releases, then evict least recently used unreferenced entries down to budget
+extern void assetCacheEndFrame(void);
+extern AssetCacheStats assetCacheGetStats(void);
+#endif
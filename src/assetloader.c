@@ -0,0 +1,259 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <raylib.h>
+#include "assetloader.h"
+#include "outline.h"
+#include "pack.h"
+#include "resample.h"
+#include "texcache.h"
+
+enum {
+    JOB_QUEUED,
+    JOB_DECODING,
+    JOB_DONE,
+    JOB_CANCELLED,
+};
+
+typedef struct AssetJob {
+    struct AssetJob *next;
+    AssetKind kind;
+    int state;
+    int target;
+    AssetImage decoded;
+    char path[];
+} AssetJob;
+
+static pthread_t gWorkers[ASSET_WORKERS];
+static int gWorkerCount = 0;
+static pthread_mutex_t gJobLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gJobReady = PTHREAD_COND_INITIALIZER;
+static AssetJob *gJobs = NULL; // FIFO, oldest first
+static bool gStop = false;
+static int gTarget = 0; // screen height, 0 keeps every image at full size
+
+static void unlinkJob(AssetJob *job) {
+    for (AssetJob **it = &gJobs; *it; it = &(*it)->next) {
+        if (*it == job) {
+            *it = job->next;
+            return;
+        }
+    }
+}
+
+static AssetJob *findJob(int state) {
+    for (AssetJob *job = gJobs; job; job = job->next)
+        if (job->state == state) return job;
+    return NULL;
+}
+
+static void *assetWorker(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&gJobLock);
+    while (!gStop) {
+        AssetJob *job = findJob(JOB_QUEUED);
+        if (!job) {
+            pthread_cond_wait(&gJobReady, &gJobLock);
+            continue;
+        }
+        job->state = JOB_DECODING;
+        int target = job->target;
+        pthread_mutex_unlock(&gJobLock);
+
+        // File read and decode, the only part that has to stay off the render thread, a packed file is decoded in place
+        size_t size = 0;
+        const unsigned char *packed = packFind(job->path, &size);
+        // Pixels decoded and resampled on an earlier visit or launch only have to be read back
+        uint32_t variant = (uint32_t)job->kind | (uint32_t)target << 8;
+        TexCacheKey source = texCacheKey(job->path, packed, size);
+        AssetImage decoded = { .target = target };
+        decoded.image = texCacheLoad(job->path, variant, source, &decoded.sourceWidth, &decoded.sourceHeight);
+        bool decodedHere = !decoded.image.data;
+        if (decodedHere) {
+            Image image = packed ? LoadImageFromMemory(GetFileExtension(job->path), packed, (int)size) : LoadImage(job->path);
+            if (image.data && image.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8)
+                ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+            // Sprites are cached with their outline already drawn in, at source size so it shrinks with the sprite
+            if (job->kind == ASSET_SPRITE) outlineBake(&image, OUTLINE_SIZE, OUTLINE_COLOR);
+            decoded.sourceWidth = image.width;
+            decoded.sourceHeight = image.height;
+            int height = assetLoaderFitHeight(job->kind, image.height, target);
+            if (image.data && height < image.height) {
+                int width = (int)((double)image.width * height / image.height + 0.5);
+                resampleImage(&image, width > 0 ? width : 1, height);
+            }
+            decoded.image = image;
+        }
+
+        // A job cancelled by an edit or a new screen size was decoded from what is now out of date
+        pthread_mutex_lock(&gJobLock);
+        bool cancelled = job->state == JOB_CANCELLED;
+        pthread_mutex_unlock(&gJobLock);
+        if (decodedHere && !cancelled)
+            texCacheStore(job->path, variant, source, decoded.image, decoded.sourceWidth, decoded.sourceHeight);
+
+        pthread_mutex_lock(&gJobLock);
+        if (job->state == JOB_CANCELLED) {
+            unlinkJob(job);
+            UnloadImage(decoded.image);
+            free(job);
+        } else {
+            job->decoded = decoded;
+            job->state = JOB_DONE;
+        }
+    }
+    pthread_mutex_unlock(&gJobLock);
+    return NULL;
+}
+
+void assetLoaderInit(int workers) {
+    if (workers > ASSET_WORKERS) workers = ASSET_WORKERS;
+    gStop = false;
+    for (gWorkerCount = 0; gWorkerCount < workers; gWorkerCount++) {
+        if (pthread_create(&gWorkers[gWorkerCount], NULL, assetWorker, NULL) != 0) {
+            TraceLog(LOG_WARNING, "Could not start asset worker %d", gWorkerCount);
+            break;
+        }
+    }
+}
+
+void assetLoaderShutdown(void) {
+    pthread_mutex_lock(&gJobLock);
+    gStop = true;
+    pthread_cond_broadcast(&gJobReady);
+    pthread_mutex_unlock(&gJobLock);
+    for (int i = 0; i < gWorkerCount; i++)
+        pthread_join(gWorkers[i], NULL);
+    gWorkerCount = 0;
+    assetLoaderDiscard();
+}
+
+void assetLoaderSetTarget(int screenHeight) {
+    pthread_mutex_lock(&gJobLock);
+    gTarget = screenHeight;
+    for (AssetJob *job = gJobs; job; job = job->next)
+        if (job->state == JOB_QUEUED) job->target = screenHeight;
+    pthread_mutex_unlock(&gJobLock);
+}
+
+int assetLoaderTarget(void) {
+    pthread_mutex_lock(&gJobLock);
+    int target = gTarget;
+    pthread_mutex_unlock(&gJobLock);
+    return target;
+}
+
+// Backgrounds are drawn one screen tall, nothing is ever scaled up
+int assetLoaderFitHeight(AssetKind kind, int sourceHeight, int target) {
+    if (target <= 0) return sourceHeight;
+    if (kind == ASSET_BACKGROUND) return sourceHeight > target ? target : sourceHeight;
+    int drawn = (int)(target * SPRITE_SCREEN_HEIGHT + 0.5f);
+    return sourceHeight > drawn * SPRITE_RESAMPLE_RATIO ? drawn : sourceHeight;
+}
+
+// Queue a decode unless one already covers it, reread supersedes decodes that read the file before it changed
+// The same file may be wanted as a background and as a sprite, each kind is decoded and handed over on its own
+static bool queueJob(AssetKind kind, const char *path, bool reread) {
+    size_t len = strlen(path) + 1;
+    bool inFlight = false;
+    pthread_mutex_lock(&gJobLock);
+    for (AssetJob *job = gJobs; job; job = job->next) {
+        if (job->state == JOB_CANCELLED || job->kind != kind || strcmp(job->path, path) != 0) continue;
+        inFlight = true;
+        // A queued job has not read the file yet and is always sized for the current target
+        if (job->state == JOB_QUEUED || (job->target == gTarget && !reread)) {
+            pthread_mutex_unlock(&gJobLock);
+            return true;
+        }
+        // Sized for the old screen or read the old file, it is never handed over so it cannot land on top of the new one
+        if (job->state == JOB_DECODING) {
+            job->state = JOB_CANCELLED;
+        } else if (job->state == JOB_DONE) {
+            unlinkJob(job);
+            UnloadImage(job->decoded.image);
+            free(job);
+        }
+        break;
+    }
+    pthread_mutex_unlock(&gJobLock);
+    if (reread && !inFlight) return false;
+
+    AssetJob *job = calloc(1, sizeof(AssetJob) + len);
+    if (!job) return false;
+    job->kind = kind;
+    job->state = JOB_QUEUED;
+    memcpy(job->path, path, len);
+
+    pthread_mutex_lock(&gJobLock);
+    job->target = gTarget;
+    AssetJob **tail = &gJobs;
+    while (*tail) tail = &(*tail)->next;
+    *tail = job;
+    pthread_cond_signal(&gJobReady);
+    pthread_mutex_unlock(&gJobLock);
+    return true;
+}
+
+bool assetLoaderRequest(AssetKind kind, const char *path) {
+    return queueJob(kind, path, false);
+}
+
+bool assetLoaderReload(AssetKind kind, const char *path) {
+    return queueJob(kind, path, true);
+}
+
+bool assetLoaderPending(AssetKind kind, const char *path) {
+    bool pending = false;
+    pthread_mutex_lock(&gJobLock);
+    for (AssetJob *job = gJobs; job; job = job->next) {
+        if (job->state != JOB_CANCELLED && job->kind == kind && strcmp(job->path, path) == 0) {
+            pending = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&gJobLock);
+    return pending;
+}
+
+bool assetLoaderBusy(void) {
+    pthread_mutex_lock(&gJobLock);
+    bool busy = findJob(JOB_QUEUED) || findJob(JOB_DECODING) || findJob(JOB_DONE);
+    pthread_mutex_unlock(&gJobLock);
+    return busy;
+}
+
+int assetLoaderUpload(double budget, AssetReadyFn ready) {
+    double start = GetTime();
+    int uploaded = 0;
+    do {
+        pthread_mutex_lock(&gJobLock);
+        AssetJob *job = findJob(JOB_DONE);
+        if (job) unlinkJob(job);
+        pthread_mutex_unlock(&gJobLock);
+        if (!job) break;
+
+        if (job->decoded.image.data) uploaded++;
+        else TraceLog(LOG_WARNING, "Failed to decode image: %s", job->path);
+        ready(job->kind, job->path, job->decoded);
+        free(job);
+    } while (GetTime() - start < budget);
+    return uploaded;
+}
+
+void assetLoaderDiscard(void) {
+    pthread_mutex_lock(&gJobLock);
+    AssetJob **it = &gJobs;
+    while (*it) {
+        AssetJob *job = *it;
+        if (job->state == JOB_DECODING || job->state == JOB_CANCELLED) {
+            // The worker owns it until the decode returns
+            job->state = JOB_CANCELLED;
+            it = &job->next;
+            continue;
+        }
+        *it = job->next;
+        if (job->state == JOB_DONE) UnloadImage(job->decoded.image);
+        free(job);
+    }
+    pthread_mutex_unlock(&gJobLock);
+}
@@ -0,0 +1,52 @@
+#ifndef ASSETLOADER_H
+#define ASSETLOADER_H
+#include <stdbool.h>
+#include <raylib.h>
+
+#define ASSET_WORKERS 2
+#define UPLOAD_BUDGET 0.004 // seconds of texture upload allowed per frame
+#define SPRITE_SCREEN_HEIGHT (4.0f / 3.0f) // sprites are drawn this many screen heights tall
+#define SPRITE_RESAMPLE_RATIO 2.0f         // sprites drawn smaller than their size by more than this are resampled
+
+typedef enum {
+    ASSET_BACKGROUND,
+    ASSET_SPRITE,
+    ASSET_KIND_COUNT,
+} AssetKind;
+
+// A decoded RGBA8 image, resampled smaller than its source when the screen cannot show it all
+typedef struct {
+    Image image;
+    int sourceWidth;  // layout stays in source pixels whatever size the image was resampled to
+    int sourceHeight;
+    int target;       // the screen height it was sized for
+} AssetImage;
+
+// Called on the main thread with a decoded image to upload and unload, an empty image if decoding failed
+typedef void (*AssetReadyFn)(AssetKind kind, const char *path, AssetImage decoded);
+
+// Start the worker threads that read and decode images off the main thread
+extern void assetLoaderInit(int workers);
+extern void assetLoaderShutdown(void);
+
+// The screen height images are sized for from now on, queued images are sized for it too
+extern void assetLoaderSetTarget(int screenHeight);
+extern int assetLoaderTarget(void);
+// The height an image of sourceHeight is resampled to for a screen target pixels high
+extern int assetLoaderFitHeight(AssetKind kind, int sourceHeight, int target);
+
+// Queue an image for decoding, requests for a kind and path already in flight at the current target are ignored
+// One sized for an earlier target is superseded
+extern bool assetLoaderRequest(AssetKind kind, const char *path);
+// The file changed, a decode of it as kind already under way is done again from the new file, false when there is none
+extern bool assetLoaderReload(AssetKind kind, const char *path);
+extern bool assetLoaderPending(AssetKind kind, const char *path);
+// Whether any image is still queued, decoding or waiting for upload
+extern bool assetLoaderBusy(void);
+
+// Hand decoded images to ready until budget seconds have passed, always hands over at least one
+extern int assetLoaderUpload(double budget, AssetReadyFn ready);
+
+// Drop every queued and decoded job that has not been uploaded yet
+extern void assetLoaderDiscard(void);
+#endif
@@ -0,0 +1,326 @@
+#include <stdlib.h>
+#include <string.h>
+#include "atlas.h"
+
+struct AtlasRegion {
+    struct AtlasRegion *next;
+    int page;
+    int x, y;          // packed position, padding included
+    int width, height; // image size
+};
+
+typedef struct {
+    int x, y, width;
+} SkylineNode;
+
+typedef struct {
+    Texture2D texture;   // id 0 while the page is unused
+    Image pixels;        // what the texture holds
+    int size;
+    SkylineNode nodes[ATLAS_SKYLINE_NODES];
+    int nodeCount;
+    size_t packed;       // area handed out since the page was last reset or repacked
+    size_t live;         // area of the regions still in use
+    AtlasRegion *regions;
+    int count;
+} AtlasPage;
+
+static AtlasPage gPages[ATLAS_MAX_PAGES];
+static unsigned long gRepacks = 0;
+static unsigned long gGrows = 0;
+
+static inline int paddedWidth(const AtlasRegion *region) {
+    return region->width + 2 * ATLAS_PADDING;
+}
+
+static inline int paddedHeight(const AtlasRegion *region) {
+    return region->height + 2 * ATLAS_PADDING;
+}
+
+static void resetSkyline(AtlasPage *page) {
+    page->nodes[0] = (SkylineNode){ 0, 0, page->size };
+    page->nodeCount = 1;
+    page->packed = 0;
+}
+
+// Lowest y a width x height rectangle can sit at when its left edge is on node index, -1 if it does not fit
+static int skylineFit(const AtlasPage *page, int index, int width, int height) {
+    int x = page->nodes[index].x;
+    if (x + width > page->size) return -1;
+    int y = 0;
+    int left = width;
+    for (int i = index; left > 0; i++) {
+        if (i >= page->nodeCount) return -1;
+        if (page->nodes[i].y > y) y = page->nodes[i].y;
+        if (y + height > page->size) return -1;
+        left -= page->nodes[i].width;
+    }
+    return y;
+}
+
+// Bottom left skyline placement, lowest resulting top edge first and the narrowest node on ties
+static bool skylinePack(AtlasPage *page, int width, int height, int *outX, int *outY) {
+    int best = -1, bestTop = page->size + 1, bestWidth = page->size + 1, bestY = 0;
+    for (int i = 0; i < page->nodeCount; i++) {
+        int y = skylineFit(page, i, width, height);
+        if (y < 0) continue;
+        if (y + height < bestTop || (y + height == bestTop && page->nodes[i].width < bestWidth)) {
+            best = i;
+            bestTop = y + height;
+            bestWidth = page->nodes[i].width;
+            bestY = y;
+        }
+    }
+    if (best < 0 || page->nodeCount >= ATLAS_SKYLINE_NODES) return false;
+
+    SkylineNode node = { page->nodes[best].x, bestY + height, width };
+    memmove(&page->nodes[best + 1], &page->nodes[best], (page->nodeCount - best) * sizeof(SkylineNode));
+    page->nodes[best] = node;
+    page->nodeCount++;
+
+    // Trim the nodes the new one now covers
+    for (int i = best + 1; i < page->nodeCount; i++) {
+        int end = page->nodes[i - 1].x + page->nodes[i - 1].width;
+        if (page->nodes[i].x >= end) break;
+        int shrink = end - page->nodes[i].x;
+        page->nodes[i].x += shrink;
+        page->nodes[i].width -= shrink;
+        if (page->nodes[i].width > 0) break;
+        memmove(&page->nodes[i], &page->nodes[i + 1], (page->nodeCount - i - 1) * sizeof(SkylineNode));
+        page->nodeCount--;
+        i--;
+    }
+    // Merge neighbours at the same height
+    for (int i = 0; i < page->nodeCount - 1; i++) {
+        if (page->nodes[i].y != page->nodes[i + 1].y) continue;
+        page->nodes[i].width += page->nodes[i + 1].width;
+        memmove(&page->nodes[i + 1], &page->nodes[i + 2], (page->nodeCount - i - 2) * sizeof(SkylineNode));
+        page->nodeCount--;
+        i--;
+    }
+    page->packed += (size_t)width * height;
+    *outX = node.x;
+    *outY = bestY;
+    return true;
+}
+
+static bool openPage(AtlasPage *page, int size) {
+    page->pixels = GenImageColor(size, size, BLANK);
+    page->texture = LoadTextureFromImage(page->pixels);
+    if (page->texture.id == 0) {
+        UnloadImage(page->pixels);
+        page->pixels = (Image){ 0 };
+        return false;
+    }
+    page->size = size;
+    resetSkyline(page);
+    page->live = 0;
+    page->regions = NULL;
+    page->count = 0;
+    return true;
+}
+
+static void closePage(AtlasPage *page) {
+    UnloadTexture(page->texture);
+    UnloadImage(page->pixels);
+    page->texture = (Texture2D){ 0 };
+    page->pixels = (Image){ 0 };
+}
+
+// Double a page, regions keep their place and the skyline gains the new columns on the right
+static bool growPage(AtlasPage *page) {
+    if (page->size >= ATLAS_PAGE_SIZE) return false;
+    SkylineNode *last = &page->nodes[page->nodeCount - 1];
+    if (last->y != 0 && page->nodeCount >= ATLAS_SKYLINE_NODES) return false;
+    int size = page->size * 2;
+    Image pixels = GenImageColor(size, size, BLANK);
+    for (int y = 0; y < page->size; y++)
+        memcpy((unsigned char *)pixels.data + (size_t)y * size * 4,
+               (unsigned char *)page->pixels.data + (size_t)y * page->size * 4, (size_t)page->size * 4);
+    Texture2D texture = LoadTextureFromImage(pixels);
+    if (texture.id == 0) {
+        UnloadImage(pixels);
+        return false;
+    }
+    closePage(page);
+    page->texture = texture;
+    page->pixels = pixels;
+    if (last->y == 0) last->width += size - page->size;
+    else page->nodes[page->nodeCount++] = (SkylineNode){ page->size, 0, size - page->size };
+    page->size = size;
+    gGrows++;
+    TraceLog(LOG_INFO, "Grew atlas page %d to %dx%d", (int)(page - gPages), size, size);
+    return true;
+}
+
+static int compareHeight(const void *a, const void *b) {
+    const AtlasRegion *ra = *(AtlasRegion *const *)a, *rb = *(AtlasRegion *const *)b;
+    return rb->height - ra->height;
+}
+
+// Pack the live regions again from scratch, tallest first, and move their texels to match
+static bool repackPage(AtlasPage *page) {
+    AtlasRegion **order = malloc(page->count * sizeof(AtlasRegion *));
+    int *positions = malloc(page->count * 2 * sizeof(int));
+    if (!order || !positions) {
+        free(order);
+        free(positions);
+        return false;
+    }
+    int n = 0;
+    for (AtlasRegion *region = page->regions; region; region = region->next)
+        order[n++] = region;
+    qsort(order, n, sizeof(AtlasRegion *), compareHeight);
+
+    // Dry run on a copy first, the page is only touched once every region has a place
+    AtlasPage *trial = malloc(sizeof(AtlasPage));
+    bool fits = trial != NULL;
+    if (fits) {
+        trial->size = page->size;
+        resetSkyline(trial);
+        for (int i = 0; i < n && fits; i++)
+            fits = skylinePack(trial, paddedWidth(order[i]), paddedHeight(order[i]), &positions[2 * i], &positions[2 * i + 1]);
+    }
+    if (!fits) {
+        free(trial);
+        free(order);
+        free(positions);
+        return false;
+    }
+
+    Image packed = GenImageColor(page->size, page->size, BLANK);
+    const unsigned char *src = page->pixels.data;
+    unsigned char *dst = packed.data;
+    for (int i = 0; i < n; i++) {
+        AtlasRegion *region = order[i];
+        size_t rowBytes = (size_t)paddedWidth(region) * 4;
+        for (int y = 0; y < paddedHeight(region); y++) {
+            memcpy(dst + ((size_t)(positions[2 * i + 1] + y) * page->size + positions[2 * i]) * 4,
+                   src + ((size_t)(region->y + y) * page->size + region->x) * 4, rowBytes);
+        }
+        region->x = positions[2 * i];
+        region->y = positions[2 * i + 1];
+    }
+    UpdateTexture(page->texture, packed.data);
+    UnloadImage(page->pixels);
+    page->pixels = packed;
+
+    memcpy(page->nodes, trial->nodes, sizeof(page->nodes));
+    page->nodeCount = trial->nodeCount;
+    page->packed = trial->packed;
+    free(trial);
+    free(order);
+    free(positions);
+    gRepacks++;
+    TraceLog(LOG_INFO, "Repacked atlas page %d (%d regions)", (int)(page - gPages), n);
+    return true;
+}
+
+static AtlasRegion *place(int pageIndex, Image image) {
+    AtlasPage *page = &gPages[pageIndex];
+    int x, y;
+    if (!skylinePack(page, image.width + 2 * ATLAS_PADDING, image.height + 2 * ATLAS_PADDING, &x, &y)) return NULL;
+    AtlasRegion *region = malloc(sizeof(AtlasRegion));
+    if (!region) return NULL;
+    *region = (AtlasRegion){ page->regions, pageIndex, x, y, image.width, image.height };
+    page->regions = region;
+    page->count++;
+    page->live += (size_t)paddedWidth(region) * paddedHeight(region);
+    for (int row = 0; row < image.height; row++)
+        memcpy((unsigned char *)page->pixels.data + ((size_t)(y + ATLAS_PADDING + row) * page->size + x + ATLAS_PADDING) * 4,
+               (const unsigned char *)image.data + (size_t)row * image.width * 4, (size_t)image.width * 4);
+    UpdateTextureRec(page->texture, atlasRect(region), image.data);
+    return region;
+}
+
+AtlasRegion *atlasAdd(Image image) {
+    if (!image.data || image.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8) return NULL;
+    if (image.width > ATLAS_MAX_REGION || image.height > ATLAS_MAX_REGION) return NULL;
+
+    for (int i = 0; i < ATLAS_MAX_PAGES; i++) {
+        if (gPages[i].texture.id == 0) continue;
+        AtlasRegion *region = place(i, image);
+        if (region) return region;
+    }
+    // Only pages with enough left behind by freed regions are worth packing again
+    for (int i = 0; i < ATLAS_MAX_PAGES; i++) {
+        AtlasPage *page = &gPages[i];
+        if (page->texture.id == 0 || (float)(page->packed - page->live) < ATLAS_REPACK_WASTE * page->size * page->size) continue;
+        if (!repackPage(page)) continue;
+        AtlasRegion *region = place(i, image);
+        if (region) return region;
+    }
+    for (int i = 0; i < ATLAS_MAX_PAGES; i++) {
+        if (gPages[i].texture.id == 0) continue;
+        while (growPage(&gPages[i])) {
+            AtlasRegion *region = place(i, image);
+            if (region) return region;
+        }
+    }
+    // A new page starts small unless the image needs more
+    int size = ATLAS_PAGE_MIN;
+    while (size < image.width + 2 * ATLAS_PADDING || size < image.height + 2 * ATLAS_PADDING)
+        size *= 2;
+    if (size > ATLAS_PAGE_SIZE) return NULL;
+    for (int i = 0; i < ATLAS_MAX_PAGES; i++) {
+        if (gPages[i].texture.id != 0) continue;
+        if (!openPage(&gPages[i], size)) return NULL;
+        return place(i, image);
+    }
+    return NULL;
+}
+
+void atlasFree(AtlasRegion *region) {
+    if (!region) return;
+    AtlasPage *page = &gPages[region->page];
+    for (AtlasRegion **it = &page->regions; *it; it = &(*it)->next) {
+        if (*it == region) {
+            *it = region->next;
+            break;
+        }
+    }
+    page->count--;
+    page->live -= (size_t)paddedWidth(region) * paddedHeight(region);
+    free(region);
+    if (page->count == 0) closePage(page);
+}
+
+Texture2D atlasTexture(const AtlasRegion *region) {
+    return gPages[region->page].texture;
+}
+
+Rectangle atlasRect(const AtlasRegion *region) {
+    return (Rectangle){ (float)(region->x + ATLAS_PADDING), (float)(region->y + ATLAS_PADDING),
+                        (float)region->width, (float)region->height };
+}
+
+size_t atlasBytes(const AtlasRegion *region) {
+    return (size_t)paddedWidth(region) * paddedHeight(region) * 4;
+}
+
+void atlasClear(void) {
+    for (int i = 0; i < ATLAS_MAX_PAGES; i++) {
+        AtlasPage *page = &gPages[i];
+        while (page->regions) {
+            AtlasRegion *next = page->regions->next;
+            free(page->regions);
+            page->regions = next;
+        }
+        if (page->texture.id != 0) closePage(page);
+        memset(page, 0, sizeof(AtlasPage));
+    }
+}
+
+AtlasStats atlasGetStats(void) {
+    AtlasStats stats = { 0 };
+    stats.repacks = gRepacks;
+    stats.grows = gGrows;
+    for (int i = 0; i < ATLAS_MAX_PAGES; i++) {
+        if (gPages[i].texture.id == 0) continue;
+        stats.pages++;
+        stats.regions += gPages[i].count;
+        stats.liveBytes += gPages[i].live * 4;
+        stats.pageBytes += (size_t)gPages[i].size * gPages[i].size * 4;
+    }
+    return stats;
+}
@@ -0,0 +1,37 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+#include <stdbool.h>
+#include <raylib.h>
+
+#define ATLAS_PAGE_MIN 1024       // pages open at this size and double when a region fits nowhere else
+#define ATLAS_PAGE_SIZE 4096      // largest a page grows to
+#define ATLAS_MAX_PAGES 4
+#define ATLAS_MAX_REGION 2048     // larger images keep a texture of their own
+#define ATLAS_PADDING 2           // transparent texels around each region against filtering bleed
+#define ATLAS_REPACK_WASTE 0.25f  // fraction of a full page's packed area left behind by freed regions
+#define ATLAS_SKYLINE_NODES 512
+
+// A rectangle of an atlas page, it keeps its identity when the page is repacked
+typedef struct AtlasRegion AtlasRegion;
+
+typedef struct {
+    int pages;
+    int regions;
+    unsigned long repacks;
+    unsigned long grows;
+    size_t liveBytes;   // texels in live regions, padding included
+    size_t pageBytes;   // texels of every allocated page, resident whatever the regions use
+} AtlasStats;
+
+// Copy an RGBA8 image into an atlas page, NULL when it is too large or every page is full
+// Every page keeps a copy of its texels in memory, repacking and growing never read the texture back
+extern AtlasRegion *atlasAdd(Image image);
+extern void atlasFree(AtlasRegion *region);
+extern Texture2D atlasTexture(const AtlasRegion *region);
+extern Rectangle atlasRect(const AtlasRegion *region);
+// Bytes the region accounts for, padding included
+extern size_t atlasBytes(const AtlasRegion *region);
+// Unload every page, outstanding regions become invalid
+extern void atlasClear(void);
+extern AtlasStats atlasGetStats(void);
+#endif
@@ -0,0 +1,101 @@
+#include <stdlib.h>
+#include <string.h>
+#include "commandqueue.h"
+#include "intern.h"
+
+static SceneCommand *gRing = NULL;
+static int gCapacity = 0;
+static int gHead = 0; // oldest command
+static int gCount = 0;
+static int gLines = 0;
+static CommandQueueStats gStats;
+
+static inline bool endsLine(const SceneCommand *command) {
+    return command->kind == COMMAND_TEXT || command->kind == COMMAND_CHOICES;
+}
+
+static void holdStrings(const SceneCommand *command, void (*hold)(int id)) {
+    hold(command->file);
+    hold(command->id);
+    hold(command->name);
+    hold(command->text);
+    for (int i = 0; i < command->choiceCount; i++) {
+        hold(command->choices[i].text);
+        hold(command->choices[i].scene);
+    }
+}
+
+void commandRetain(const SceneCommand *command) {
+    holdStrings(command, internRetain);
+}
+
+void commandRelease(const SceneCommand *command) {
+    holdStrings(command, internRelease);
+}
+
+// Doubled with the oldest command moved to the front, only a scene that could not stop at the usual capacity gets here
+static bool grow(void) {
+    int capacity = gCapacity ? gCapacity * 2 : COMMAND_QUEUE_CAPACITY;
+    SceneCommand *ring = malloc(capacity * sizeof(SceneCommand));
+    if (!ring) return false;
+    int first = gCount < gCapacity - gHead ? gCount : gCapacity - gHead;
+    if (gCount > 0) {
+        memcpy(ring, gRing + gHead, first * sizeof(SceneCommand));
+        memcpy(ring + first, gRing, (gCount - first) * sizeof(SceneCommand));
+    }
+    free(gRing);
+    gRing = ring;
+    gCapacity = capacity;
+    gHead = 0;
+    return true;
+}
+
+bool commandQueuePush(const SceneCommand *command) {
+    if (gCount == gCapacity && !grow()) return false;
+    commandRetain(command);
+    gRing[(gHead + gCount) % gCapacity] = *command;
+    gCount++;
+    if (endsLine(command)) gLines++;
+    gStats.recorded++;
+    return true;
+}
+
+bool commandQueuePop(SceneCommand *out) {
+    if (gCount == 0) return false;
+    *out = gRing[gHead];
+    // Still valid for the caller, strings are only freed by internCollect
+    commandRelease(out);
+    gHead = (gHead + 1) % gCapacity;
+    gCount--;
+    if (endsLine(out)) gLines--;
+    gStats.applied++;
+    return true;
+}
+
+int commandQueueSize(void) {
+    return gCount;
+}
+
+int commandQueueLines(void) {
+    return gLines;
+}
+
+void commandQueueClear(void) {
+    for (int i = 0; i < gCount; i++)
+        commandRelease(&gRing[(gHead + i) % gCapacity]);
+    gStats.discarded += gCount;
+    gHead = 0;
+    gCount = 0;
+    gLines = 0;
+    // Back to the usual size once a scene that grew it is gone
+    if (gCapacity > COMMAND_QUEUE_CAPACITY) {
+        free(gRing);
+        gRing = NULL;
+        gCapacity = 0;
+    }
+}
+
+CommandQueueStats commandQueueGetStats(void) {
+    gStats.lines = gLines;
+    return gStats;
+}
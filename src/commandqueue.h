@@ -0,0 +1,63 @@
+#ifndef COMMANDQUEUE_H
+#define COMMANDQUEUE_H
+#include <stdbool.h>
+#include <raylib.h>
+
+#define COMMAND_QUEUE_CAPACITY 256 // commands held ahead of the player, a scene past this runs live where it can stop
+#define COMMAND_MAX_CHOICES 10
+
+// Engine calls a scene made ahead of the player, applied once the player reaches them
+typedef enum {
+    COMMAND_BACKGROUND,
+    COMMAND_SPRITE,
+    COMMAND_UNLOAD_SPRITE,
+    COMMAND_FONT,
+    COMMAND_MUSIC,
+    COMMAND_SOUND,
+    COMMAND_TEXT,     // ends a line
+    COMMAND_CLEAR_TEXT,
+    COMMAND_CHOICES,  // ends a line, nothing after it runs until a choice is taken
+    COMMAND_GLOBAL,   // an assignment to a script global, held back until the player reaches it
+} CommandKind;
+
+// Every string is an interned id (see intern.h), file paths are resolved against the module when recorded
+typedef struct {
+    CommandKind kind;
+    int file;
+    int id;
+    Vector2 pos;
+    float start;
+    int name;
+    int text;
+    Color nameColor;
+    Color textColor;
+    bool hasPos;
+    int slot; // COMMAND_GLOBAL, which of the scene's held back assignments
+    int choiceCount;
+    struct {
+        int text;
+        int scene;
+    } choices[COMMAND_MAX_CHOICES];
+} SceneCommand;
+
+typedef struct {
+    unsigned long recorded;
+    unsigned long applied;
+    unsigned long discarded; // dropped by a scene change or rewind before the player got to them
+    int lines;               // complete lines currently queued
+} CommandQueueStats;
+
+// Retain or release every string a command names, for commands kept outside the queue
+extern void commandRetain(const SceneCommand *command);
+extern void commandRelease(const SceneCommand *command);
+// Grows past COMMAND_QUEUE_CAPACITY rather than fail, false only when out of memory
+// A queued command retains its strings until it is taken or cleared
+extern bool commandQueuePush(const SceneCommand *command);
+// Take the oldest command
+extern bool commandQueuePop(SceneCommand *out);
+extern int commandQueueSize(void);
+// Queued commands that end a line
+extern int commandQueueLines(void);
+extern void commandQueueClear(void);
+extern CommandQueueStats commandQueueGetStats(void);
+#endif
@@ -0,0 +1,90 @@
+#include <stdbool.h>
+#include <raylib.h>
+#include "../external/cc.h"
+#include "../build/lua/lauxlib.h"
+#include "coroutines.h"
+
+typedef struct {
+    lua_State *thread;
+    int ref; // registry reference keeping the thread alive
+} Coroutine;
+
+static vec(Coroutine) gLive;
+static vec(Coroutine) gRetired;
+static vec(Coroutine) gPool;
+static bool gInit = false;
+static unsigned long gCreated = 0;
+static unsigned long gReused = 0;
+
+static void initLists(void) {
+    if (gInit) return;
+    init(&gLive);
+    init(&gRetired);
+    init(&gPool);
+    gInit = true;
+}
+
+lua_State *coroutineAcquire(lua_State *L) {
+    initLists();
+    Coroutine co;
+    if (size(&gPool) > 0) {
+        co = *last(&gPool);
+        erase(&gPool, size(&gPool) - 1);
+        gReused++;
+    } else {
+        co.thread = lua_newthread(L);
+        co.ref = luaL_ref(L, LUA_REGISTRYINDEX); // pops the thread
+        gCreated++;
+    }
+    if (!push(&gLive, co)) {
+        luaL_unref(L, LUA_REGISTRYINDEX, co.ref);
+        return NULL;
+    }
+    return co.thread;
+}
+
+void coroutineRelease(lua_State *thread) {
+    if (!thread || !gInit) return;
+    for (size_t i = 0; i < size(&gLive); i++) {
+        Coroutine *co = get(&gLive, i);
+        if (co->thread != thread) continue;
+        // Still anchored while retired, a running thread must not be collected under its caller
+        if (push(&gRetired, *co)) erase(&gLive, i);
+        return;
+    }
+}
+
+void coroutineCollect(lua_State *L) {
+    if (!gInit) return;
+    for_each(&gRetired, co) {
+        // Closes pending to-be-closed variables and shrinks the stack back down
+        if (lua_closethread(co->thread, L) != LUA_OK)
+            TraceLog(LOG_WARNING, "Error closing scene coroutine: %s", lua_tostring(co->thread, -1));
+        lua_settop(co->thread, 0);
+        if (size(&gPool) >= COROUTINE_POOL || !push(&gPool, *co))
+            luaL_unref(L, LUA_REGISTRYINDEX, co->ref);
+    }
+    clear(&gRetired);
+}
+
+void coroutineClear(lua_State *L) {
+    if (!gInit) return;
+    for_each(&gLive, co) luaL_unref(L, LUA_REGISTRYINDEX, co->ref);
+    for_each(&gRetired, co) luaL_unref(L, LUA_REGISTRYINDEX, co->ref);
+    for_each(&gPool, co) luaL_unref(L, LUA_REGISTRYINDEX, co->ref);
+    clear(&gLive);
+    clear(&gRetired);
+    clear(&gPool);
+}
+
+CoroutineStats coroutineGetStats(void) {
+    CoroutineStats stats = { 0 };
+    if (gInit) {
+        stats.live = (int)size(&gLive);
+        stats.retired = (int)size(&gRetired);
+        stats.pooled = (int)size(&gPool);
+    }
+    stats.created = gCreated;
+    stats.reused = gReused;
+    return stats;
+}
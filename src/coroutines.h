@@ -0,0 +1,24 @@
+#ifndef COROUTINES_H
+#define COROUTINES_H
+#include "../build/lua/lua.h"
+
+#define COROUTINE_POOL 4 // reset threads kept for the next scene, the rest are left to the collector
+
+typedef struct {
+    int live;              // handed out and not released yet
+    int retired;           // released, reset at the next coroutineCollect
+    int pooled;
+    unsigned long created;
+    unsigned long reused;
+} CoroutineStats;
+
+// A thread anchored in the registry, so it stays alive without sitting on L's stack
+extern lua_State *coroutineAcquire(lua_State *L);
+// The thread may still be running (a scene calling pop_state), it is only reset by coroutineCollect
+extern void coroutineRelease(lua_State *thread);
+// Reset released threads for reuse, only call it while no coroutine is running
+extern void coroutineCollect(lua_State *L);
+// Drop every anchor, live threads included
+extern void coroutineClear(lua_State *L);
+extern CoroutineStats coroutineGetStats(void);
+#endif
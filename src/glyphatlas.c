@@ -0,0 +1,353 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <raylib.h>
+#include "glyphatlas.h"
+#include "textlayout.h"
+
+#define GLSL_VERSION 330
+#define STRING_GLYPHS 512            // distinct codepoints looked at per string
+#define LOOKUP_SLOTS (2 * GLYPH_ATLAS_PAGE_GLYPHS)
+#define CACHE_MAGIC 0x41474e56       // "VNGA"
+#define CACHE_VERSION 1
+
+typedef struct {
+    Font font;                 // texture id 0 while the page is unused
+    int lookup[LOOKUP_SLOTS];  // codepoint hash to glyph index + 1, 0 for an empty slot
+    int shelfX, shelfY, shelfHeight;
+    unsigned long lastUse;
+} GlyphPage;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int32_t baseSize;
+    int32_t pageSize;
+    int32_t pages;
+    int32_t fontBytes;
+    int64_t modTime;
+} CacheHeader;
+
+typedef struct {
+    int32_t glyphCount;
+    int32_t shelfX, shelfY, shelfHeight;
+} CachePage;
+
+typedef struct {
+    int32_t value, offsetX, offsetY, advanceX;
+    float x, y, width, height;
+} CacheGlyph;
+
+static GlyphPage gPages[GLYPH_ATLAS_MAX_PAGES];
+static unsigned char *gFontData = NULL;
+static int gFontBytes = 0;
+static char *gPath = NULL;
+static long gModTime = 0;
+static Shader gShader = { 0 };
+static bool gDirty = false;
+static unsigned long gClock = 0;
+static GlyphAtlasStats gStats;
+
+static inline unsigned int slotOf(int codepoint) {
+    return ((uint32_t)codepoint * 2654435761u) % LOOKUP_SLOTS;
+}
+
+static int findGlyph(const GlyphPage *page, int codepoint) {
+    for (unsigned int slot = slotOf(codepoint);; slot = (slot + 1) % LOOKUP_SLOTS) {
+        int index = page->lookup[slot] - 1;
+        if (index < 0) return -1;
+        if (page->font.glyphs[index].value == codepoint) return index;
+    }
+}
+
+static void indexGlyph(GlyphPage *page, int codepoint, int index) {
+    unsigned int slot = slotOf(codepoint);
+    while (page->lookup[slot] != 0) slot = (slot + 1) % LOOKUP_SLOTS;
+    page->lookup[slot] = index + 1;
+}
+
+// pixels is a page of grayscale texels, NULL for a blank page
+static bool openPage(GlyphPage *page, void *pixels) {
+    void *blank = NULL;
+    if (!pixels) pixels = blank = calloc(GLYPH_ATLAS_PAGE_SIZE, GLYPH_ATLAS_PAGE_SIZE);
+    page->font.recs = calloc(GLYPH_ATLAS_PAGE_GLYPHS, sizeof(Rectangle));
+    page->font.glyphs = calloc(GLYPH_ATLAS_PAGE_GLYPHS, sizeof(GlyphInfo));
+    if (pixels && page->font.recs && page->font.glyphs) {
+        Image image = { pixels, GLYPH_ATLAS_PAGE_SIZE, GLYPH_ATLAS_PAGE_SIZE, 1, PIXELFORMAT_UNCOMPRESSED_GRAYSCALE };
+        page->font.texture = LoadTextureFromImage(image);
+    }
+    free(blank);
+    if (page->font.texture.id == 0) {
+        free(page->font.recs);
+        free(page->font.glyphs);
+        memset(page, 0, sizeof(GlyphPage));
+        TraceLog(LOG_WARNING, "Could not create glyph page");
+        return false;
+    }
+    // Distance fields have to be filtered to stay smooth when scaled
+    SetTextureFilter(page->font.texture, TEXTURE_FILTER_BILINEAR);
+    page->font.baseSize = GLYPH_ATLAS_BASE_SIZE;
+    page->font.glyphPadding = 0;
+    page->font.glyphCount = 0;
+    page->lastUse = ++gClock;
+    return true;
+}
+
+static void closePage(GlyphPage *page) {
+    if (page->font.texture.id != 0) UnloadTexture(page->font.texture);
+    free(page->font.recs);
+    free(page->font.glyphs);
+    memset(page, 0, sizeof(GlyphPage));
+}
+
+static void resetPage(GlyphPage *page) {
+    void *blank = calloc(GLYPH_ATLAS_PAGE_SIZE, GLYPH_ATLAS_PAGE_SIZE);
+    if (blank) UpdateTexture(page->font.texture, blank);
+    free(blank);
+    page->font.glyphCount = 0;
+    memset(page->lookup, 0, sizeof(page->lookup));
+    page->shelfX = page->shelfY = page->shelfHeight = 0;
+    // Cached layouts and glyph tables point into the cleared page
+    textLayoutClear();
+    gStats.evictions++;
+}
+
+static bool placeGlyph(GlyphPage *page, const GlyphInfo *glyph) {
+    if (page->font.glyphCount == GLYPH_ATLAS_PAGE_GLYPHS) return false;
+    // Spaces only need their advance
+    bool blank = glyph->value == ' ' || !glyph->image.data;
+    int width = blank ? 0 : glyph->image.width;
+    int height = blank ? 0 : glyph->image.height;
+    if (page->shelfX + width > GLYPH_ATLAS_PAGE_SIZE) {
+        page->shelfX = 0;
+        page->shelfY += page->shelfHeight + GLYPH_ATLAS_GUTTER;
+        page->shelfHeight = 0;
+    }
+    if (page->shelfY + height > GLYPH_ATLAS_PAGE_SIZE) return false;
+
+    Rectangle rec = { (float)page->shelfX, (float)page->shelfY, (float)width, (float)height };
+    if (!blank) UpdateTextureRec(page->font.texture, rec, glyph->image.data);
+    int index = page->font.glyphCount++;
+    page->font.recs[index] = rec;
+    page->font.glyphs[index] = *glyph;
+    page->font.glyphs[index].image = (Image){ 0 };
+    indexGlyph(page, glyph->value, index);
+    page->shelfX += width + GLYPH_ATLAS_GUTTER;
+    if (height > page->shelfHeight) page->shelfHeight = height;
+    return true;
+}
+
+// Returns whether every codepoint made it onto the page
+static bool rasterize(GlyphPage *page, int *codepoints, int count) {
+    GlyphInfo *glyphs = LoadFontData(gFontData, gFontBytes, GLYPH_ATLAS_BASE_SIZE, codepoints, count, FONT_SDF);
+    if (!glyphs) return false;
+    int placed = 0;
+    while (placed < count && placeGlyph(page, &glyphs[placed])) placed++;
+    UnloadFontData(glyphs, count);
+    gStats.rasterized += placed;
+    gDirty = true;
+    return placed == count;
+}
+
+static int collectCodepoints(const char *text, int *codepoints) {
+    int count = 0;
+    for (int i = 0; text[i] && count < STRING_GLYPHS;) {
+        int size = 0;
+        int codepoint = GetCodepoint(&text[i], &size);
+        // Bad bytes are drawn as '?' one byte at a time, as in the layout
+        if (codepoint == 0x3f) size = 1;
+        i += size;
+        if (codepoint == '\n') continue;
+        bool seen = false;
+        for (int j = 0; j < count && !seen; j++) seen = codepoints[j] == codepoint;
+        if (!seen) codepoints[count++] = codepoint;
+    }
+    return count;
+}
+
+static GlyphPage *leastRecentPage(void) {
+    GlyphPage *victim = &gPages[0];
+    for (int i = 0; i < GLYPH_ATLAS_MAX_PAGES; i++) {
+        if (gPages[i].font.texture.id == 0) return &gPages[i];
+        if (gPages[i].lastUse < victim->lastUse) victim = &gPages[i];
+    }
+    return victim;
+}
+
+static void cachePath(char *out, size_t size) {
+    snprintf(out, size, "%s%s", gPath, GLYPH_ATLAS_CACHE_SUFFIX);
+}
+
+static bool readCache(void) {
+    char path[1024];
+    cachePath(path, sizeof(path));
+    FILE *in = fopen(path, "rb");
+    if (!in) return false;
+    CacheHeader header;
+    bool ok = fread(&header, sizeof(header), 1, in) == 1 && header.magic == CACHE_MAGIC &&
+              header.version == CACHE_VERSION && header.baseSize == GLYPH_ATLAS_BASE_SIZE &&
+              header.pageSize == GLYPH_ATLAS_PAGE_SIZE && header.pages <= GLYPH_ATLAS_MAX_PAGES &&
+              header.fontBytes == gFontBytes && header.modTime == gModTime;
+    unsigned char *pixels = ok ? malloc(GLYPH_ATLAS_PAGE_SIZE * GLYPH_ATLAS_PAGE_SIZE) : NULL;
+    for (int p = 0; ok && pixels && p < header.pages; p++) {
+        CachePage info;
+        ok = fread(&info, sizeof(info), 1, in) == 1 && info.glyphCount >= 0 && info.glyphCount <= GLYPH_ATLAS_PAGE_GLYPHS;
+        CacheGlyph *glyphs = ok ? malloc((info.glyphCount + 1) * sizeof(CacheGlyph)) : NULL;
+        ok = ok && glyphs && fread(glyphs, sizeof(CacheGlyph), info.glyphCount, in) == (size_t)info.glyphCount &&
+             fread(pixels, GLYPH_ATLAS_PAGE_SIZE, GLYPH_ATLAS_PAGE_SIZE, in) == GLYPH_ATLAS_PAGE_SIZE &&
+             openPage(&gPages[p], pixels);
+        for (int i = 0; ok && i < info.glyphCount; i++) {
+            GlyphPage *page = &gPages[p];
+            page->font.recs[i] = (Rectangle){ glyphs[i].x, glyphs[i].y, glyphs[i].width, glyphs[i].height };
+            page->font.glyphs[i] = (GlyphInfo){ glyphs[i].value, glyphs[i].offsetX, glyphs[i].offsetY, glyphs[i].advanceX, { 0 } };
+            indexGlyph(page, glyphs[i].value, i);
+            page->font.glyphCount++;
+        }
+        if (ok) {
+            gPages[p].shelfX = info.shelfX;
+            gPages[p].shelfY = info.shelfY;
+            gPages[p].shelfHeight = info.shelfHeight;
+        }
+        free(glyphs);
+    }
+    free(pixels);
+    fclose(in);
+    if (!ok) {
+        for (int i = 0; i < GLYPH_ATLAS_MAX_PAGES; i++) closePage(&gPages[i]);
+        TraceLog(LOG_INFO, "Ignoring stale glyph cache %s", path);
+    }
+    return ok;
+}
+
+static void writeCache(void) {
+    char path[1024];
+    cachePath(path, sizeof(path));
+    FILE *out = fopen(path, "wb");
+    if (!out) {
+        TraceLog(LOG_WARNING, "Could not write glyph cache %s", path);
+        return;
+    }
+    CacheHeader header = { CACHE_MAGIC, CACHE_VERSION, GLYPH_ATLAS_BASE_SIZE, GLYPH_ATLAS_PAGE_SIZE, 0, gFontBytes, gModTime };
+    for (int p = 0; p < GLYPH_ATLAS_MAX_PAGES; p++)
+        if (gPages[p].font.texture.id != 0) header.pages++;
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    for (int p = 0; ok && p < GLYPH_ATLAS_MAX_PAGES; p++) {
+        GlyphPage *page = &gPages[p];
+        if (page->font.texture.id == 0) continue;
+        Image image = LoadImageFromTexture(page->font.texture);
+        if (image.data && image.format != PIXELFORMAT_UNCOMPRESSED_GRAYSCALE)
+            ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_GRAYSCALE);
+        CachePage info = { page->font.glyphCount, page->shelfX, page->shelfY, page->shelfHeight };
+        ok = image.data && fwrite(&info, sizeof(info), 1, out) == 1;
+        for (int i = 0; ok && i < page->font.glyphCount; i++) {
+            const GlyphInfo *glyph = &page->font.glyphs[i];
+            Rectangle rec = page->font.recs[i];
+            CacheGlyph entry = { glyph->value, glyph->offsetX, glyph->offsetY, glyph->advanceX, rec.x, rec.y, rec.width, rec.height };
+            ok = fwrite(&entry, sizeof(entry), 1, out) == 1;
+        }
+        ok = ok && fwrite(image.data, GLYPH_ATLAS_PAGE_SIZE, GLYPH_ATLAS_PAGE_SIZE, out) == GLYPH_ATLAS_PAGE_SIZE;
+        UnloadImage(image);
+    }
+    fclose(out);
+    // A partial file would only be rejected on the next launch, drop it now
+    if (!ok) remove(path);
+    else TraceLog(LOG_INFO, "Saved %d glyph pages to %s", header.pages, path);
+}
+
+bool glyphAtlasLoad(const char *path) {
+    glyphAtlasUnload();
+    gFontData = LoadFileData(path, &gFontBytes);
+    if (!gFontData) return false;
+    gPath = malloc(strlen(path) + 1);
+    if (!gPath) {
+        glyphAtlasUnload();
+        return false;
+    }
+    strcpy(gPath, path);
+    gModTime = GetFileModTime(path);
+    gShader = LoadShader(0, TextFormat("src/sdf-%i.fs", GLSL_VERSION));
+    memset(&gStats, 0, sizeof(gStats));
+    gStats.warm = readCache();
+    gDirty = false;
+    TraceLog(LOG_INFO, "Loaded font %s (%s glyph cache)", path, gStats.warm ? "warm" : "cold");
+    return true;
+}
+
+void glyphAtlasUnload(void) {
+    if (gFontData && gDirty) writeCache();
+    textLayoutClear();
+    for (int i = 0; i < GLYPH_ATLAS_MAX_PAGES; i++) closePage(&gPages[i]);
+    if (gShader.id != 0) UnloadShader(gShader);
+    gShader = (Shader){ 0 };
+    UnloadFileData(gFontData);
+    gFontData = NULL;
+    gFontBytes = 0;
+    free(gPath);
+    gPath = NULL;
+    gDirty = false;
+}
+
+bool glyphAtlasActive(void) {
+    return gFontData != NULL;
+}
+
+Font glyphAtlasFont(const char *text) {
+    if (!gFontData) return GetFontDefault();
+    int codepoints[STRING_GLYPHS];
+    int count = collectCodepoints(text, codepoints);
+
+    // The page already holding most of the string, so a string is always drawn from a single texture
+    GlyphPage *best = NULL;
+    int bestMissing = 0;
+    for (int i = 0; i < GLYPH_ATLAS_MAX_PAGES; i++) {
+        GlyphPage *page = &gPages[i];
+        if (page->font.texture.id == 0) continue;
+        int missing = 0;
+        for (int j = 0; j < count; j++)
+            if (findGlyph(page, codepoints[j]) < 0) missing++;
+        if (!best || missing < bestMissing || (missing == bestMissing && page->lastUse > best->lastUse)) {
+            best = page;
+            bestMissing = missing;
+        }
+    }
+    if (!best) {
+        best = &gPages[0];
+        if (!openPage(best, NULL)) return GetFontDefault();
+        bestMissing = count;
+    }
+
+    if (bestMissing > 0) {
+        int missing[STRING_GLYPHS];
+        int missingCount = 0;
+        for (int j = 0; j < count; j++)
+            if (findGlyph(best, codepoints[j]) < 0) missing[missingCount++] = codepoints[j];
+        if (!rasterize(best, missing, missingCount)) {
+            // Start the whole string over on a fresh or the least recently used page
+            GlyphPage *victim = leastRecentPage();
+            if (victim->font.texture.id == 0) {
+                if (!openPage(victim, NULL)) victim = best;
+            }
+            if (victim->font.glyphCount > 0) resetPage(victim);
+            if (!rasterize(victim, codepoints, count))
+                TraceLog(LOG_WARNING, "Glyphs of \"%s\" do not fit on one page", text);
+            best = victim;
+        }
+    }
+    best->lastUse = ++gClock;
+    return best->font;
+}
+
+Shader glyphAtlasShader(void) {
+    return gShader;
+}
+
+GlyphAtlasStats glyphAtlasGetStats(void) {
+    GlyphAtlasStats stats = gStats;
+    for (int i = 0; i < GLYPH_ATLAS_MAX_PAGES; i++) {
+        if (gPages[i].font.texture.id == 0) continue;
+        stats.pages++;
+        stats.glyphs += gPages[i].font.glyphCount;
+    }
+    return stats;
+}
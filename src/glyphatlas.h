@@ -0,0 +1,30 @@
+#ifndef GLYPHATLAS_H
+#define GLYPHATLAS_H
+#include <stdbool.h>
+#include <raylib.h>
+
+#define GLYPH_ATLAS_BASE_SIZE 32       // SDF raster size, the sdf shader keeps edges sharp at any draw size
+#define GLYPH_ATLAS_PAGE_SIZE 1024
+#define GLYPH_ATLAS_MAX_PAGES 4        // least recently used page is cleared when a string fits nowhere
+#define GLYPH_ATLAS_PAGE_GLYPHS 1024
+#define GLYPH_ATLAS_GUTTER 1           // texels between glyphs
+#define GLYPH_ATLAS_CACHE_SUFFIX ".glyphs" // pages are saved next to the font file
+
+typedef struct {
+    int pages;
+    int glyphs;               // across every page, a glyph may live on more than one
+    unsigned long rasterized; // since the font was loaded
+    unsigned long evictions;
+    bool warm;                // pages came from the on disk cache
+} GlyphAtlasStats;
+
+// Use a TTF/OTF file for dialog text, glyphs are rasterized the first time a string needs them
+extern bool glyphAtlasLoad(const char *path);
+// Save the pages for the next launch and release the font
+extern void glyphAtlasUnload(void);
+extern bool glyphAtlasActive(void);
+// A page holding every glyph of text, drawn with glyphAtlasShader() and laid out like any raylib font
+extern Font glyphAtlasFont(const char *text);
+extern Shader glyphAtlasShader(void);
+extern GlyphAtlasStats glyphAtlasGetStats(void);
+#endif
@@ -0,0 +1,771 @@
+// The subset of raylib the engine calls, backed by nothing, for running on machines without a display or sound card
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <stdatomic.h>
+#include <raylib.h>
+#include <rlgl.h>
+#include "headless.h"
+
+#define TEXT_FORMAT_BUFFERS 4
+#define TEXT_FORMAT_LENGTH 1024
+#define SHADER_LOCATIONS 32
+#define DEFAULT_FONT_FIRST 32  // printable Latin-1 like the font raylib builds in, raygui takes glyph 95 as its white square
+#define DEFAULT_FONT_GLYPHS 224
+#define DEFAULT_FONT_SIZE 10
+#define MONITOR_WIDTH 1920
+#define MONITOR_HEIGHT 1080
+#define MUSIC_BITRATE 16000    // bytes per second assumed when guessing a track's length from its file size
+#define SAMPLE_RATE 44100
+#define PATH_LENGTH 4096
+
+static int gLogLevel = LOG_INFO;
+static double gStartTime = -1.0;
+static int gScreenWidth = 0;
+static int gScreenHeight = 0;
+static unsigned int gNextId = 2; // 1 is the default font's texture
+static Font gDefaultFont = { 0 };
+static char gNullBuffer;         // stands in for the audio buffers streams point to
+static float gMasterVolume = 1.0f;
+
+// Textures are only touched on the main thread, sounds and music streams also from the music thread
+static HeadlessStats gStats = { 0 };
+static atomic_int gSounds;
+static atomic_int gMusicStreams;
+
+HeadlessStats headlessGetStats(void) {
+    HeadlessStats stats = gStats;
+    stats.sounds = atomic_load(&gSounds);
+    stats.musicStreams = atomic_load(&gMusicStreams);
+    return stats;
+}
+
+/* Window, input and timing */
+
+double GetTime(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    double now = ts.tv_sec + ts.tv_nsec / 1e9;
+    if (gStartTime < 0) gStartTime = now;
+    return now - gStartTime;
+}
+
+void InitWindow(int width, int height, const char *title) {
+    gScreenWidth = width;
+    gScreenHeight = height;
+    GetTime();
+    TraceLog(LOG_INFO, "HEADLESS: %s, %dx%d with no display", title, width, height);
+}
+
+void CloseWindow(void) {
+    if (gDefaultFont.glyphs) {
+        free(gDefaultFont.glyphs);
+        free(gDefaultFont.recs);
+        gDefaultFont = (Font){ 0 };
+    }
+}
+
+// Nobody is there to close it, an interactive run ends after its first frame
+bool WindowShouldClose(void) { return true; }
+void SetWindowSize(int width, int height) { gScreenWidth = width; gScreenHeight = height; }
+void SetWindowPosition(int x, int y) { }
+void ToggleBorderlessWindowed(void) { }
+int GetScreenWidth(void) { return gScreenWidth; }
+int GetScreenHeight(void) { return gScreenHeight; }
+int GetMonitorWidth(int monitor) { return MONITOR_WIDTH; }
+int GetMonitorHeight(int monitor) { return MONITOR_HEIGHT; }
+void SetTargetFPS(int fps) { }
+void EnableEventWaiting(void) { }
+void DisableEventWaiting(void) { }
+const char *GetClipboardText(void) { return ""; }
+
+bool IsKeyPressed(int key) { return false; }
+bool IsKeyDown(int key) { return false; }
+int GetCharPressed(void) { return 0; }
+bool IsMouseButtonPressed(int button) { return false; }
+bool IsMouseButtonDown(int button) { return false; }
+bool IsMouseButtonReleased(int button) { return false; }
+Vector2 GetMousePosition(void) { return (Vector2){ 0, 0 }; }
+float GetMouseWheelMove(void) { return 0.0f; }
+
+/* Logging and text */
+
+void SetTraceLogLevel(int logLevel) {
+    gLogLevel = logLevel;
+}
+
+// Always to stderr, stdout is left for the bench report
+void TraceLog(int logLevel, const char *text, ...) {
+    if (logLevel < gLogLevel) return;
+    static const char *prefixes[] = { "", "TRACE: ", "DEBUG: ", "INFO: ", "WARNING: ", "ERROR: ", "FATAL: ", "" };
+    fputs(prefixes[logLevel >= LOG_ALL && logLevel <= LOG_NONE ? logLevel : LOG_NONE], stderr);
+    va_list args;
+    va_start(args, text);
+    vfprintf(stderr, text, args);
+    va_end(args);
+    fputc('\n', stderr);
+    if (logLevel == LOG_FATAL) exit(EXIT_FAILURE);
+}
+
+const char *TextFormat(const char *text, ...) {
+    static char buffers[TEXT_FORMAT_BUFFERS][TEXT_FORMAT_LENGTH];
+    static int index = 0;
+    char *buffer = buffers[index];
+    index = (index + 1) % TEXT_FORMAT_BUFFERS;
+    va_list args;
+    va_start(args, text);
+    vsnprintf(buffer, TEXT_FORMAT_LENGTH, text, args);
+    va_end(args);
+    return buffer;
+}
+
+unsigned int TextLength(const char *text) {
+    return text ? (unsigned int)strlen(text) : 0;
+}
+
+int TextToInteger(const char *text) {
+    return (int)strtol(text, NULL, 10);
+}
+
+float TextToFloat(const char *text) {
+    return strtof(text, NULL);
+}
+
+// Bad sequences come back as '?' one byte long, as in raylib
+int GetCodepointNext(const char *text, int *codepointSize) {
+    const unsigned char *ptr = (const unsigned char *)text;
+    *codepointSize = 1;
+    if ((ptr[0] & 0xf8) == 0xf0) {
+        if ((ptr[1] & 0xc0) != 0x80 || (ptr[2] & 0xc0) != 0x80 || (ptr[3] & 0xc0) != 0x80) return 0x3f;
+        *codepointSize = 4;
+        return ((ptr[0] & 0x07) << 18) | ((ptr[1] & 0x3f) << 12) | ((ptr[2] & 0x3f) << 6) | (ptr[3] & 0x3f);
+    }
+    if ((ptr[0] & 0xf0) == 0xe0) {
+        if ((ptr[1] & 0xc0) != 0x80 || (ptr[2] & 0xc0) != 0x80) return 0x3f;
+        *codepointSize = 3;
+        return ((ptr[0] & 0x0f) << 12) | ((ptr[1] & 0x3f) << 6) | (ptr[2] & 0x3f);
+    }
+    if ((ptr[0] & 0xe0) == 0xc0) {
+        if ((ptr[1] & 0xc0) != 0x80) return 0x3f;
+        *codepointSize = 2;
+        return ((ptr[0] & 0x1f) << 6) | (ptr[1] & 0x3f);
+    }
+    if ((ptr[0] & 0x80) == 0) return ptr[0];
+    return 0x3f;
+}
+
+int GetCodepoint(const char *text, int *codepointSize) {
+    return GetCodepointNext(text, codepointSize);
+}
+
+int GetCodepointPrevious(const char *text, int *codepointSize) {
+    const unsigned char *ptr = (const unsigned char *)text;
+    do ptr--; while ((ptr[0] & 0xc0) == 0x80);
+    int size = 0;
+    int codepoint = GetCodepointNext((const char *)ptr, &size);
+    *codepointSize = codepoint != 0 ? size : 0;
+    return codepoint;
+}
+
+const char *CodepointToUTF8(int codepoint, int *utf8Size) {
+    static char utf8[6];
+    int size = 0;
+    if (codepoint <= 0x7f) {
+        utf8[0] = (char)codepoint;
+        size = 1;
+    } else if (codepoint <= 0x7ff) {
+        utf8[0] = (char)(((codepoint >> 6) & 0x1f) | 0xc0);
+        utf8[1] = (char)((codepoint & 0x3f) | 0x80);
+        size = 2;
+    } else if (codepoint <= 0xffff) {
+        utf8[0] = (char)(((codepoint >> 12) & 0x0f) | 0xe0);
+        utf8[1] = (char)(((codepoint >> 6) & 0x3f) | 0x80);
+        utf8[2] = (char)((codepoint & 0x3f) | 0x80);
+        size = 3;
+    } else if (codepoint <= 0x10ffff) {
+        utf8[0] = (char)(((codepoint >> 18) & 0x07) | 0xf0);
+        utf8[1] = (char)(((codepoint >> 12) & 0x3f) | 0x80);
+        utf8[2] = (char)(((codepoint >> 6) & 0x3f) | 0x80);
+        utf8[3] = (char)((codepoint & 0x3f) | 0x80);
+        size = 4;
+    }
+    *utf8Size = size;
+    return utf8;
+}
+
+int *LoadCodepoints(const char *text, int *count) {
+    int *codepoints = malloc(((size_t)TextLength(text) + 1) * sizeof(int));
+    int n = 0;
+    for (int i = 0; text[i];) {
+        int size = 0;
+        codepoints[n++] = GetCodepointNext(&text[i], &size);
+        i += size;
+    }
+    *count = n;
+    return codepoints;
+}
+
+void UnloadCodepoints(int *codepoints) {
+    free(codepoints);
+}
+
+/* Files */
+
+bool FileExists(const char *fileName) {
+    struct stat st;
+    return stat(fileName, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+bool DirectoryExists(const char *dirPath) {
+    struct stat st;
+    return stat(dirPath, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+long GetFileModTime(const char *fileName) {
+    struct stat st;
+    return stat(fileName, &st) == 0 ? (long)st.st_mtime : 0;
+}
+
+int GetFileLength(const char *fileName) {
+    struct stat st;
+    return stat(fileName, &st) == 0 ? (int)st.st_size : 0;
+}
+
+const char *GetFileName(const char *filePath) {
+    const char *slash = strrchr(filePath, '/');
+    const char *backslash = strrchr(filePath, '\\');
+    if (backslash > slash) slash = backslash;
+    return slash ? slash + 1 : filePath;
+}
+
+const char *GetFileExtension(const char *fileName) {
+    const char *dot = strrchr(GetFileName(fileName), '.');
+    return dot && dot != GetFileName(fileName) ? dot : NULL;
+}
+
+const char *GetDirectoryPath(const char *filePath) {
+    static char path[PATH_LENGTH];
+    const char *name = GetFileName(filePath);
+    size_t length = (size_t)(name - filePath);
+    if (length == 0) return ".";
+    if (length > 1) length--; // keep the slash of a root path
+    if (length >= sizeof(path)) length = sizeof(path) - 1;
+    memcpy(path, filePath, length);
+    path[length] = '\0';
+    return path;
+}
+
+unsigned char *LoadFileData(const char *fileName, int *dataSize) {
+    *dataSize = 0;
+    FILE *file = fopen(fileName, "rb");
+    if (!file) {
+        TraceLog(LOG_WARNING, "FILEIO: [%s] Failed to open file", fileName);
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    unsigned char *data = size > 0 ? malloc((size_t)size) : NULL;
+    if (data) *dataSize = (int)fread(data, 1, (size_t)size, file);
+    fclose(file);
+    return data;
+}
+
+void UnloadFileData(unsigned char *data) {
+    free(data);
+}
+
+char *LoadFileText(const char *fileName) {
+    int size = 0;
+    unsigned char *data = LoadFileData(fileName, &size);
+    if (!data) return NULL;
+    char *text = realloc(data, (size_t)size + 1);
+    if (!text) {
+        free(data);
+        return NULL;
+    }
+    text[size] = '\0';
+    return text;
+}
+
+void UnloadFileText(char *text) {
+    free(text);
+}
+
+// Style files ship uncompressed fonts only when raygui finds no decompressor
+unsigned char *DecompressData(const unsigned char *compData, int compDataSize, int *dataSize) {
+    *dataSize = 0;
+    return NULL;
+}
+
+// filter is a ';' separated list of extensions, directories are only listed when it holds "DIR"
+static bool matchesFilter(const char *path, bool isDir, const char *filter) {
+    if (isDir) return filter && strstr(filter, "DIR") != NULL;
+    if (!filter) return true;
+    const char *extension = strrchr(GetFileName(path), '.');
+    if (!extension) return false;
+    size_t length = strlen(extension);
+    for (const char *item = filter; *item;) {
+        const char *end = strchr(item, ';');
+        size_t itemLength = end ? (size_t)(end - item) : strlen(item);
+        if (itemLength == length && strncasecmp(item, extension, length) == 0) return true;
+        if (!end) break;
+        item = end + 1;
+    }
+    return false;
+}
+
+static void scanDirectory(FilePathList *files, const char *basePath, const char *filter, bool scanSubdirs) {
+    DIR *dir = opendir(basePath);
+    if (!dir) return;
+    struct dirent *entry;
+    while ((entry = readdir(dir))) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        char path[PATH_LENGTH];
+        snprintf(path, sizeof(path), "%s/%s", basePath, entry->d_name);
+        bool isDir = DirectoryExists(path);
+        if (matchesFilter(path, isDir, filter)) {
+            if (files->count == files->capacity) {
+                unsigned int capacity = files->capacity ? files->capacity * 2 : 64;
+                char **paths = realloc(files->paths, capacity * sizeof(char *));
+                if (!paths) break;
+                files->paths = paths;
+                files->capacity = capacity;
+            }
+            files->paths[files->count++] = strdup(path);
+        }
+        if (isDir && scanSubdirs) scanDirectory(files, path, filter, scanSubdirs);
+    }
+    closedir(dir);
+}
+
+FilePathList LoadDirectoryFilesEx(const char *basePath, const char *filter, bool scanSubdirs) {
+    FilePathList files = { 0 };
+    scanDirectory(&files, basePath, filter, scanSubdirs);
+    return files;
+}
+
+void UnloadDirectoryFiles(FilePathList files) {
+    for (unsigned int i = 0; i < files.count; i++)
+        free(files.paths[i]);
+    free(files.paths);
+}
+
+/* Images and textures */
+
+int GetPixelDataSize(int width, int height, int format) {
+    int bpp = 0;
+    switch (format) {
+        case PIXELFORMAT_UNCOMPRESSED_GRAYSCALE: bpp = 8; break;
+        case PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA:
+        case PIXELFORMAT_UNCOMPRESSED_R5G6B5:
+        case PIXELFORMAT_UNCOMPRESSED_R5G5B5A1:
+        case PIXELFORMAT_UNCOMPRESSED_R4G4B4A4:
+        case PIXELFORMAT_UNCOMPRESSED_R16: bpp = 16; break;
+        case PIXELFORMAT_UNCOMPRESSED_R8G8B8: bpp = 24; break;
+        case PIXELFORMAT_UNCOMPRESSED_R8G8B8A8:
+        case PIXELFORMAT_UNCOMPRESSED_R32: bpp = 32; break;
+        case PIXELFORMAT_UNCOMPRESSED_R16G16B16: bpp = 48; break;
+        case PIXELFORMAT_UNCOMPRESSED_R16G16B16A16: bpp = 64; break;
+        case PIXELFORMAT_UNCOMPRESSED_R32G32B32: bpp = 96; break;
+        case PIXELFORMAT_UNCOMPRESSED_R32G32B32A32: bpp = 128; break;
+        case PIXELFORMAT_COMPRESSED_DXT1_RGB:
+        case PIXELFORMAT_COMPRESSED_DXT1_RGBA:
+        case PIXELFORMAT_COMPRESSED_ETC1_RGB:
+        case PIXELFORMAT_COMPRESSED_ETC2_RGB:
+        case PIXELFORMAT_COMPRESSED_PVRT_RGB:
+        case PIXELFORMAT_COMPRESSED_PVRT_RGBA: bpp = 4; break;
+        case PIXELFORMAT_COMPRESSED_DXT3_RGBA:
+        case PIXELFORMAT_COMPRESSED_DXT5_RGBA:
+        case PIXELFORMAT_COMPRESSED_ETC2_EAC_RGBA:
+        case PIXELFORMAT_COMPRESSED_ASTC_4x4_RGBA: bpp = 8; break;
+        case PIXELFORMAT_COMPRESSED_ASTC_8x8_RGBA: bpp = 2; break;
+        default: break;
+    }
+    return (int)((long long)width * height * bpp / 8);
+}
+
+static size_t textureBytes(Texture2D texture) {
+    size_t bytes = 0;
+    int width = texture.width, height = texture.height;
+    for (int level = 0; level < (texture.mipmaps > 0 ? texture.mipmaps : 1); level++) {
+        bytes += (size_t)GetPixelDataSize(width, height, texture.format);
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    return bytes;
+}
+
+static void trackTexture(Texture2D texture) {
+    gStats.textures++;
+    gStats.textureBytes += textureBytes(texture);
+    if (gStats.textureBytes > gStats.peakTextureBytes) gStats.peakTextureBytes = gStats.textureBytes;
+}
+
+static void untrackTexture(Texture2D texture) {
+    gStats.textures--;
+    gStats.textureBytes -= textureBytes(texture);
+}
+
+Image GenImageColor(int width, int height, Color color) {
+    Color *pixels = malloc((size_t)width * height * sizeof(Color));
+    if (!pixels) return (Image){ 0 };
+    for (size_t i = 0; i < (size_t)width * height; i++)
+        pixels[i] = color;
+    return (Image){ pixels, width, height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+}
+
+static unsigned int readBig32(const unsigned char *p) {
+    return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | p[3];
+}
+
+// Dimensions from the header of a PNG, JPEG, BMP or QOI file, false for anything else
+static bool imageSize(const unsigned char *data, int size, int *width, int *height) {
+    if (size >= 24 && memcmp(data, "\x89PNG", 4) == 0) {
+        *width = (int)readBig32(data + 16);
+        *height = (int)readBig32(data + 20);
+        return true;
+    }
+    if (size >= 14 && memcmp(data, "qoif", 4) == 0) {
+        *width = (int)readBig32(data + 4);
+        *height = (int)readBig32(data + 8);
+        return true;
+    }
+    if (size >= 26 && memcmp(data, "BM", 2) == 0) {
+        int w = data[18] | (data[19] << 8) | (data[20] << 16) | (data[21] << 24);
+        int h = data[22] | (data[23] << 8) | (data[24] << 16) | (data[25] << 24);
+        *width = w;
+        *height = h < 0 ? -h : h;
+        return true;
+    }
+    if (size >= 4 && data[0] == 0xff && data[1] == 0xd8) {
+        // Walk the segments up to the start of frame, any SOFn but DHT, JPG and DAC
+        int i = 2;
+        while (i + 9 < size) {
+            if (data[i] != 0xff) return false;
+            int marker = data[i + 1];
+            int length = (data[i + 2] << 8) | data[i + 3];
+            if (marker >= 0xc0 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 && marker != 0xcc) {
+                *height = (data[i + 5] << 8) | data[i + 6];
+                *width = (data[i + 7] << 8) | data[i + 8];
+                return true;
+            }
+            i += 2 + length;
+        }
+    }
+    return false;
+}
+
+// Only the header is decoded, the pixels stay blank
+Image LoadImageFromMemory(const char *fileType, const unsigned char *fileData, int dataSize) {
+    int width = 0, height = 0;
+    if (!fileData || !imageSize(fileData, dataSize, &width, &height) || width <= 0 || height <= 0) {
+        TraceLog(LOG_WARNING, "IMAGE: Unsupported %s image, headless reads PNG, JPEG, BMP and QOI headers", fileType ? fileType : "unknown");
+        return (Image){ 0 };
+    }
+    return GenImageColor(width, height, BLANK);
+}
+
+// The file is still read so disk time counts
+Image LoadImage(const char *fileName) {
+    int size = 0;
+    unsigned char *data = LoadFileData(fileName, &size);
+    if (!data) return (Image){ 0 };
+    Image image = LoadImageFromMemory(GetFileExtension(fileName), data, size);
+    UnloadFileData(data);
+    return image;
+}
+
+void UnloadImage(Image image) {
+    free(image.data);
+}
+
+// Pixels are not converted, the buffer is resized for the new format and cleared
+void ImageFormat(Image *image, int newFormat) {
+    if (!image->data || image->format == newFormat) return;
+    int size = GetPixelDataSize(image->width, image->height, newFormat);
+    void *data = calloc(1, size > 0 ? (size_t)size : 1);
+    if (!data) return;
+    free(image->data);
+    image->data = data;
+    image->format = newFormat;
+    image->mipmaps = 1;
+}
+
+Texture2D LoadTextureFromImage(Image image) {
+    if (!image.data || image.width <= 0 || image.height <= 0) {
+        TraceLog(LOG_WARNING, "TEXTURE: Failed to load texture from an empty image");
+        return (Texture2D){ 0 };
+    }
+    Texture2D texture = { gNextId++, image.width, image.height, image.mipmaps, image.format };
+    trackTexture(texture);
+    return texture;
+}
+
+void UnloadTexture(Texture2D texture) {
+    if (texture.id != 0) untrackTexture(texture);
+}
+
+// Nothing was kept, so read back is as blank as every image loaded here
+Image LoadImageFromTexture(Texture2D texture) {
+    int size = GetPixelDataSize(texture.width, texture.height, texture.format);
+    if (texture.id == 0 || size <= 0) return (Image){ 0 };
+    return (Image){ calloc(1, (size_t)size), texture.width, texture.height, 1, texture.format };
+}
+
+void UpdateTexture(Texture2D texture, const void *pixels) {
+    gStats.uploadBytes += (size_t)GetPixelDataSize(texture.width, texture.height, texture.format);
+}
+
+void UpdateTextureRec(Texture2D texture, Rectangle rec, const void *pixels) {
+    gStats.uploadBytes += (size_t)GetPixelDataSize((int)rec.width, (int)rec.height, texture.format);
+}
+
+// Counted as the full chain would be on the GPU
+void GenTextureMipmaps(Texture2D *texture) {
+    if (texture->id == 0 || texture->mipmaps > 1) return;
+    untrackTexture(*texture);
+    int levels = 1;
+    for (int size = texture->width > texture->height ? texture->width : texture->height; size > 1; size /= 2)
+        levels++;
+    texture->mipmaps = levels;
+    trackTexture(*texture);
+}
+
+void SetTextureFilter(Texture2D texture, int filter) { }
+
+RenderTexture2D LoadRenderTexture(int width, int height) {
+    RenderTexture2D target = { 0 };
+    target.id = gNextId++;
+    target.texture = (Texture2D){ gNextId++, width, height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+    target.depth = (Texture2D){ gNextId++, width, height, 1, 0 };
+    trackTexture(target.texture);
+    gStats.renderTargets++;
+    return target;
+}
+
+void UnloadRenderTexture(RenderTexture2D target) {
+    if (target.id == 0) return;
+    untrackTexture(target.texture);
+    gStats.renderTargets--;
+}
+
+Shader LoadShader(const char *vsFileName, const char *fsFileName) {
+    Shader shader = { gNextId++, malloc(SHADER_LOCATIONS * sizeof(int)) };
+    for (int i = 0; shader.locs && i < SHADER_LOCATIONS; i++)
+        shader.locs[i] = -1;
+    return shader;
+}
+
+void UnloadShader(Shader shader) {
+    free(shader.locs);
+}
+
+/* Fonts */
+
+// Fixed width glyphs at the size of raylib's own default font, enough for layout and raygui to measure with
+Font GetFontDefault(void) {
+    if (gDefaultFont.glyphs) return gDefaultFont;
+    gDefaultFont.baseSize = DEFAULT_FONT_SIZE;
+    gDefaultFont.glyphCount = DEFAULT_FONT_GLYPHS;
+    gDefaultFont.texture = (Texture2D){ 1, 128, 256, 1, PIXELFORMAT_UNCOMPRESSED_GRAY_ALPHA };
+    gDefaultFont.glyphs = calloc(DEFAULT_FONT_GLYPHS, sizeof(GlyphInfo));
+    gDefaultFont.recs = calloc(DEFAULT_FONT_GLYPHS, sizeof(Rectangle));
+    if (!gDefaultFont.glyphs || !gDefaultFont.recs) {
+        free(gDefaultFont.glyphs);
+        free(gDefaultFont.recs);
+        gDefaultFont = (Font){ 0 };
+        return gDefaultFont;
+    }
+    for (int i = 0; i < DEFAULT_FONT_GLYPHS; i++) {
+        gDefaultFont.glyphs[i].value = DEFAULT_FONT_FIRST + i;
+        gDefaultFont.recs[i] = (Rectangle){ (float)(i % 16) * 8, (float)(i / 16) * 11, 5, DEFAULT_FONT_SIZE };
+    }
+    return gDefaultFont;
+}
+
+Font LoadFontEx(const char *fileName, int fontSize, int *codepoints, int codepointCount) {
+    return GetFontDefault();
+}
+
+// There is no rasterizer, so the glyph atlas never fills or rewrites its cache, a warm cache still loads
+GlyphInfo *LoadFontData(const unsigned char *fileData, int dataSize, int fontSize, int *codepoints, int codepointCount, int type) {
+    return NULL;
+}
+
+void UnloadFontData(GlyphInfo *glyphs, int glyphCount) {
+    if (!glyphs) return;
+    for (int i = 0; i < glyphCount; i++)
+        UnloadImage(glyphs[i].image);
+    free(glyphs);
+}
+
+int GetGlyphIndex(Font font, int codepoint) {
+    int fallback = 0;
+    for (int i = 0; i < font.glyphCount; i++) {
+        if (font.glyphs[i].value == codepoint) return i;
+        if (font.glyphs[i].value == '?') fallback = i;
+    }
+    return fallback;
+}
+
+Vector2 MeasureTextEx(Font font, const char *text, float fontSize, float spacing) {
+    if (!text || !text[0] || font.glyphCount == 0 || font.baseSize == 0) return (Vector2){ 0, 0 };
+    float scale = fontSize / (float)font.baseSize;
+    float width = 0, widest = 0, height = fontSize;
+    int count = 0, longest = 0;
+    for (int i = 0; text[i];) {
+        int size = 0;
+        int codepoint = GetCodepointNext(&text[i], &size);
+        i += size;
+        if (codepoint == '\n') {
+            if (width > widest) widest = width;
+            width = 0;
+            count = 0;
+            height += fontSize + 2;
+            continue;
+        }
+        int index = GetGlyphIndex(font, codepoint);
+        width += font.glyphs[index].advanceX ? font.glyphs[index].advanceX : font.recs[index].width + font.glyphs[index].offsetX;
+        if (++count > longest) longest = count;
+    }
+    if (width > widest) widest = width;
+    return (Vector2){ widest * scale + (longest - 1) * spacing, height };
+}
+
+int MeasureText(const char *text, int fontSize) {
+    if (fontSize < DEFAULT_FONT_SIZE) fontSize = DEFAULT_FONT_SIZE;
+    return (int)MeasureTextEx(GetFontDefault(), text, (float)fontSize, (float)(fontSize / DEFAULT_FONT_SIZE)).x;
+}
+
+/* Drawing, counted and dropped */
+
+void BeginDrawing(void) { }
+void EndDrawing(void) { gStats.frames++; }
+void ClearBackground(Color color) { }
+void BeginTextureMode(RenderTexture2D target) { }
+void EndTextureMode(void) { }
+void BeginShaderMode(Shader shader) { }
+void EndShaderMode(void) { }
+void BeginBlendMode(int mode) { }
+void EndBlendMode(void) { }
+void SetShapesTexture(Texture2D texture, Rectangle source) { }
+void DrawRectangle(int posX, int posY, int width, int height, Color color) { gStats.drawCalls++; }
+void DrawRectangleRec(Rectangle rec, Color color) { gStats.drawCalls++; }
+void DrawRectangleGradientV(int posX, int posY, int width, int height, Color top, Color bottom) { gStats.drawCalls++; }
+void DrawRectangleGradientEx(Rectangle rec, Color topLeft, Color bottomLeft, Color topRight, Color bottomRight) { gStats.drawCalls++; }
+void DrawTexturePro(Texture2D texture, Rectangle source, Rectangle dest, Vector2 origin, float rotation, Color tint) { gStats.drawCalls++; }
+void DrawTextureRec(Texture2D texture, Rectangle source, Vector2 position, Color tint) { gStats.drawCalls++; }
+void DrawText(const char *text, int posX, int posY, int fontSize, Color color) { gStats.drawCalls++; }
+void DrawTextCodepoint(Font font, int codepoint, Vector2 position, float fontSize, Color tint) { gStats.drawCalls++; }
+
+void rlBegin(int mode) { gStats.drawCalls++; }
+void rlEnd(void) { }
+void rlSetTexture(unsigned int id) { }
+bool rlCheckRenderBatchLimit(int vCount) { return false; }
+void rlColor4ub(unsigned char r, unsigned char g, unsigned char b, unsigned char a) { }
+void rlNormal3f(float x, float y, float z) { }
+void rlTexCoord2f(float x, float y) { }
+void rlVertex2f(float x, float y) { }
+
+Color Fade(Color color, float alpha) {
+    if (alpha < 0.0f) alpha = 0.0f;
+    else if (alpha > 1.0f) alpha = 1.0f;
+    return (Color){ color.r, color.g, color.b, (unsigned char)(255.0f * alpha) };
+}
+
+Color GetColor(unsigned int hexValue) {
+    return (Color){ (hexValue >> 24) & 0xff, (hexValue >> 16) & 0xff, (hexValue >> 8) & 0xff, hexValue & 0xff };
+}
+
+bool CheckCollisionPointRec(Vector2 point, Rectangle rec) {
+    return point.x >= rec.x && point.x < rec.x + rec.width && point.y >= rec.y && point.y < rec.y + rec.height;
+}
+
+/* Audio, streams open and close but never produce a sample */
+
+void InitAudioDevice(void) { }
+void CloseAudioDevice(void) { }
+float GetMasterVolume(void) { return gMasterVolume; }
+void SetAudioStreamBufferSizeDefault(int size) { }
+
+static AudioStream nullStream(void) {
+    return (AudioStream){ (rAudioBuffer *)&gNullBuffer, NULL, SAMPLE_RATE, 16, 2 };
+}
+
+Wave LoadWaveFromMemory(const char *fileType, const unsigned char *fileData, int dataSize) {
+    if (!fileData || dataSize <= 0) return (Wave){ 0 };
+    return (Wave){ (unsigned int)dataSize / 4, SAMPLE_RATE, 16, 2, NULL };
+}
+
+void UnloadWave(Wave wave) {
+    free(wave.data);
+}
+
+Sound LoadSoundFromWave(Wave wave) {
+    if (wave.frameCount == 0) return (Sound){ 0 };
+    atomic_fetch_add(&gSounds, 1);
+    return (Sound){ nullStream(), wave.frameCount };
+}
+
+Sound LoadSound(const char *fileName) {
+    int bytes = GetFileLength(fileName);
+    if (bytes <= 0) {
+        TraceLog(LOG_WARNING, "SOUND: [%s] Failed to open file", fileName);
+        return (Sound){ 0 };
+    }
+    return LoadSoundFromWave((Wave){ (unsigned int)bytes / 4, SAMPLE_RATE, 16, 2, NULL });
+}
+
+void UnloadSound(Sound sound) {
+    if (sound.frameCount != 0) atomic_fetch_sub(&gSounds, 1);
+}
+
+Sound LoadSoundAlias(Sound source) { return source; }
+void UnloadSoundAlias(Sound alias) { }
+void PlaySound(Sound sound) { }
+void StopSound(Sound sound) { }
+bool IsSoundPlaying(Sound sound) { return false; }
+void SetSoundVolume(Sound sound, float volume) { }
+
+Music LoadMusicStreamFromMemory(const char *fileType, const unsigned char *data, int dataSize) {
+    Music music = { 0 };
+    if (!data || dataSize <= 0) return music;
+    music.stream = nullStream();
+    music.frameCount = (unsigned int)((double)dataSize / MUSIC_BITRATE * SAMPLE_RATE) + 1;
+    music.looping = true;
+    music.ctxData = (void *)data;
+    atomic_fetch_add(&gMusicStreams, 1);
+    return music;
+}
+
+Music LoadMusicStream(const char *fileName) {
+    Music music = { 0 };
+    int bytes = GetFileLength(fileName);
+    if (bytes <= 0) {
+        TraceLog(LOG_WARNING, "STREAM: [%s] Failed to open file", fileName);
+        return music;
+    }
+    music.stream = nullStream();
+    music.frameCount = (unsigned int)((double)bytes / MUSIC_BITRATE * SAMPLE_RATE) + 1;
+    music.looping = true;
+    music.ctxData = &gNullBuffer;
+    atomic_fetch_add(&gMusicStreams, 1);
+    return music;
+}
+
+void UnloadMusicStream(Music music) {
+    if (music.frameCount != 0) atomic_fetch_sub(&gMusicStreams, 1);
+}
+
+void PlayMusicStream(Music music) { }
+void StopMusicStream(Music music) { }
+void UpdateMusicStream(Music music) { }
+void SeekMusicStream(Music music, float position) { }
+void SetMusicVolume(Music music, float volume) { }
+float GetMusicTimePlayed(Music music) { return 0.0f; }
@@ -0,0 +1,19 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+#include <stddef.h>
+
+// Linked in place of raylib by make bench, nothing is drawn or played but every texture and stream is accounted for
+typedef struct {
+    int textures;             // live, render targets included
+    int renderTargets;
+    size_t textureBytes;      // what the textures would take in VRAM
+    size_t peakTextureBytes;
+    size_t uploadBytes;       // pixels sent to textures after they were created
+    int sounds;
+    int musicStreams;
+    unsigned long frames;
+    unsigned long drawCalls;
+} HeadlessStats;
+
+extern HeadlessStats headlessGetStats(void);
+#endif
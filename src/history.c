@@ -0,0 +1,397 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "history.h"
+#include "intern.h"
+
+#define RECORD_BUFFER_SIZE 4096
+
+// Each record is a sequence of tagged groups, a delta only carries the groups that changed
+enum {
+    TAG_SCENE = 1,
+    TAG_LINE,
+    TAG_BACKGROUND,
+    TAG_MUSIC,
+    TAG_SPRITES,
+    TAG_DIALOG,
+    TAG_CHOICES,
+};
+
+// Script globals as a scene run started, shared by every record of that run
+typedef struct {
+    int refs;
+    size_t size;
+    unsigned char data[];
+} GlobalsSnapshot;
+
+typedef struct {
+    unsigned char *data;
+    unsigned int size;
+    bool keyframe;
+    GlobalsSnapshot *globals;
+} HistoryRecord;
+
+typedef struct {
+    unsigned char *buf;
+    size_t len;
+    size_t cap;
+} Writer;
+
+typedef struct {
+    const unsigned char *buf;
+    size_t len;
+    size_t pos;
+} Reader;
+
+static HistoryRecord gRing[HISTORY_CAPACITY];
+static int gHead = 0; // oldest record
+static int gCount = 0;
+static int gSinceKeyframe = 0;
+static HistoryFrame gNewest; // decoded newest entry, the base for the next delta
+static unsigned long gTransitions = 0;
+static size_t gRecordBytes = 0;
+static GlobalsSnapshot *gGlobals = NULL; // attached to every record pushed until the next scene starts
+static size_t gGlobalsBytes = 0;
+
+static inline HistoryRecord *recordAt(int index) {
+    return &gRing[(gHead + index) % HISTORY_CAPACITY];
+}
+
+static void writeByte(Writer *w, unsigned char b) {
+    if (w->len < w->cap) w->buf[w->len++] = b;
+}
+
+static void writeVarint(Writer *w, uint32_t v) {
+    while (v >= 0x80) {
+        writeByte(w, (unsigned char)(v | 0x80));
+        v >>= 7;
+    }
+    writeByte(w, (unsigned char)v);
+}
+
+static void writeFloat(Writer *w, float f) {
+    unsigned char bytes[sizeof(float)];
+    memcpy(bytes, &f, sizeof(float));
+    for (size_t i = 0; i < sizeof(float); i++) writeByte(w, bytes[i]);
+}
+
+static void writeColor(Writer *w, Color c) {
+    writeByte(w, c.r);
+    writeByte(w, c.g);
+    writeByte(w, c.b);
+    writeByte(w, c.a);
+}
+
+// Past the end reads as zero, pos still moves on so a short record can be told apart
+static unsigned char readByte(Reader *r) {
+    r->pos++;
+    return r->pos <= r->len ? r->buf[r->pos - 1] : 0;
+}
+
+static uint32_t readVarint(Reader *r) {
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        unsigned char b = readByte(r);
+        v |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) break;
+    }
+    return v;
+}
+
+static float readFloat(Reader *r) {
+    unsigned char bytes[sizeof(float)];
+    for (size_t i = 0; i < sizeof(float); i++) bytes[i] = readByte(r);
+    float f;
+    memcpy(&f, bytes, sizeof(float));
+    return f;
+}
+
+static Color readColor(Reader *r) {
+    Color c;
+    c.r = readByte(r);
+    c.g = readByte(r);
+    c.b = readByte(r);
+    c.a = readByte(r);
+    return c;
+}
+
+static bool sameColor(Color a, Color b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+static bool sameDialog(const HistoryFrame *a, const HistoryFrame *b) {
+    return a->hasDialog == b->hasDialog && a->dialogName == b->dialogName && a->dialogText == b->dialogText &&
+           sameColor(a->dialogNameColor, b->dialogNameColor) && sameColor(a->textColor, b->textColor) &&
+           a->dialogHasPos == b->dialogHasPos && a->dialogPos.x == b->dialogPos.x && a->dialogPos.y == b->dialogPos.y;
+}
+
+// With base NULL every group is written, which makes the record a keyframe
+static void encode(Writer *w, const HistoryFrame *frame, const HistoryFrame *base) {
+    if (!base || frame->scene != base->scene || frame->lastScene != base->lastScene || frame->script != base->script) {
+        writeByte(w, TAG_SCENE);
+        writeVarint(w, frame->scene);
+        writeVarint(w, frame->lastScene);
+        writeVarint(w, frame->script);
+    }
+    if (!base || frame->line != base->line) {
+        writeByte(w, TAG_LINE);
+        writeVarint(w, frame->line);
+    }
+    if (!base || frame->background != base->background) {
+        writeByte(w, TAG_BACKGROUND);
+        writeVarint(w, frame->background);
+    }
+    if (!base || frame->music != base->music) {
+        writeByte(w, TAG_MUSIC);
+        writeVarint(w, frame->music);
+    }
+    if (!base || frame->spriteCount != base->spriteCount ||
+        memcmp(frame->sprites, base->sprites, frame->spriteCount * sizeof(HistorySprite)) != 0) {
+        writeByte(w, TAG_SPRITES);
+        writeVarint(w, frame->spriteCount);
+        for (int i = 0; i < frame->spriteCount; i++) {
+            writeVarint(w, frame->sprites[i].file);
+            writeVarint(w, frame->sprites[i].id);
+            writeFloat(w, frame->sprites[i].pos.x);
+            writeFloat(w, frame->sprites[i].pos.y);
+        }
+    }
+    if (!base || !sameDialog(frame, base)) {
+        writeByte(w, TAG_DIALOG);
+        writeByte(w, (frame->hasDialog ? 1 : 0) | (frame->dialogHasPos ? 2 : 0));
+        writeVarint(w, frame->dialogName);
+        writeVarint(w, frame->dialogText);
+        writeColor(w, frame->dialogNameColor);
+        writeColor(w, frame->textColor);
+        if (frame->dialogHasPos) {
+            writeFloat(w, frame->dialogPos.x);
+            writeFloat(w, frame->dialogPos.y);
+        }
+    }
+    if (!base || frame->choiceCount != base->choiceCount ||
+        memcmp(frame->choices, base->choices, frame->choiceCount * sizeof(HistoryChoice)) != 0) {
+        writeByte(w, TAG_CHOICES);
+        writeVarint(w, frame->choiceCount);
+        for (int i = 0; i < frame->choiceCount; i++) {
+            writeVarint(w, frame->choices[i].text);
+            writeVarint(w, frame->choices[i].scene);
+        }
+    }
+}
+
+// False when the record ends early or holds an unknown group
+static bool decode(const unsigned char *data, size_t size, HistoryFrame *frame) {
+    Reader r = { data, size, 0 };
+    while (r.pos < r.len) {
+        switch (readByte(&r)) {
+            case TAG_SCENE: {
+                frame->scene = readVarint(&r);
+                frame->lastScene = readVarint(&r);
+                frame->script = readVarint(&r);
+            } break;
+            case TAG_LINE: {
+                frame->line = readVarint(&r);
+            } break;
+            case TAG_BACKGROUND: {
+                frame->background = readVarint(&r);
+            } break;
+            case TAG_MUSIC: {
+                frame->music = readVarint(&r);
+            } break;
+            case TAG_SPRITES: {
+                frame->spriteCount = readVarint(&r);
+                if (frame->spriteCount > HISTORY_MAX_SPRITES) frame->spriteCount = HISTORY_MAX_SPRITES;
+                for (int i = 0; i < frame->spriteCount; i++) {
+                    frame->sprites[i].file = readVarint(&r);
+                    frame->sprites[i].id = readVarint(&r);
+                    frame->sprites[i].pos.x = readFloat(&r);
+                    frame->sprites[i].pos.y = readFloat(&r);
+                }
+            } break;
+            case TAG_DIALOG: {
+                unsigned char flags = readByte(&r);
+                frame->hasDialog = flags & 1;
+                frame->dialogHasPos = flags & 2;
+                frame->dialogName = readVarint(&r);
+                frame->dialogText = readVarint(&r);
+                frame->dialogNameColor = readColor(&r);
+                frame->textColor = readColor(&r);
+                frame->dialogPos = (Vector2){ 0 };
+                if (frame->dialogHasPos) {
+                    frame->dialogPos.x = readFloat(&r);
+                    frame->dialogPos.y = readFloat(&r);
+                }
+            } break;
+            case TAG_CHOICES: {
+                frame->choiceCount = readVarint(&r);
+                if (frame->choiceCount > HISTORY_MAX_CHOICES) frame->choiceCount = HISTORY_MAX_CHOICES;
+                for (int i = 0; i < frame->choiceCount; i++) {
+                    frame->choices[i].text = readVarint(&r);
+                    frame->choices[i].scene = readVarint(&r);
+                }
+            } break;
+            default: return false; // corrupt record, stop rather than misread the rest
+        }
+    }
+    return r.pos == r.len;
+}
+
+// A record retains the strings it names until it is dropped, a delta only names those of the groups it carries
+static void holdStrings(const HistoryRecord *record, void (*hold)(int id)) {
+    HistoryFrame ids = { 0 };
+    decode(record->data, record->size, &ids);
+    hold(ids.scene);
+    hold(ids.lastScene);
+    hold(ids.script);
+    hold(ids.background);
+    hold(ids.music);
+    for (int i = 0; i < ids.spriteCount; i++) {
+        hold(ids.sprites[i].file);
+        hold(ids.sprites[i].id);
+    }
+    hold(ids.dialogName);
+    hold(ids.dialogText);
+    for (int i = 0; i < ids.choiceCount; i++) {
+        hold(ids.choices[i].text);
+        hold(ids.choices[i].scene);
+    }
+}
+
+static GlobalsSnapshot *retainGlobals(GlobalsSnapshot *globals) {
+    if (globals) globals->refs++;
+    return globals;
+}
+
+static void releaseGlobals(GlobalsSnapshot *globals) {
+    if (!globals || --globals->refs > 0) return;
+    gGlobalsBytes -= sizeof(GlobalsSnapshot) + globals->size;
+    free(globals);
+}
+
+static void freeRecord(HistoryRecord *record) {
+    holdStrings(record, internRelease);
+    releaseGlobals(record->globals);
+    gRecordBytes -= record->size;
+    free(record->data);
+    *record = (HistoryRecord){ 0 };
+}
+
+static void freeOldest(void) {
+    freeRecord(recordAt(0));
+    gHead = (gHead + 1) % HISTORY_CAPACITY;
+    gCount--;
+}
+
+void historyPush(const HistoryFrame *frame) {
+    bool dropped = gCount == HISTORY_CAPACITY;
+    if (dropped) {
+        // Deltas are useless without their keyframe, so drop the whole oldest group
+        do freeOldest(); while (gCount > 0 && !recordAt(0)->keyframe);
+    }
+    bool keyframe = gCount == 0 || gSinceKeyframe + 1 >= HISTORY_KEYFRAME;
+    unsigned char buf[RECORD_BUFFER_SIZE];
+    Writer w = { buf, 0, RECORD_BUFFER_SIZE };
+    encode(&w, frame, keyframe ? NULL : &gNewest);
+
+    HistoryRecord *record = recordAt(gCount);
+    record->data = malloc(w.len ? w.len : 1);
+    if (!record->data) return;
+    memcpy(record->data, buf, w.len);
+    record->size = (unsigned int)w.len;
+    record->keyframe = keyframe;
+    record->globals = retainGlobals(gGlobals);
+    holdStrings(record, internRetain);
+    gCount++;
+    gRecordBytes += w.len;
+    gSinceKeyframe = keyframe ? 0 : gSinceKeyframe + 1;
+    gNewest = *frame;
+    gTransitions++;
+    // Dialog and choice text would otherwise stay interned for the whole session
+    if (dropped) internCollect();
+}
+
+int historyCount(void) {
+    return gCount;
+}
+
+// Replay from the nearest keyframe at or before index
+static void rebuild(int index, HistoryFrame *out) {
+    int start = index;
+    while (start > 0 && !recordAt(start)->keyframe) start--;
+    memset(out, 0, sizeof(HistoryFrame));
+    for (int i = start; i <= index; i++)
+        decode(recordAt(i)->data, recordAt(i)->size, out);
+}
+
+bool historyGet(int index, HistoryFrame *out) {
+    if (index < 0 || index >= gCount) return false;
+    if (index == gCount - 1) *out = gNewest;
+    else rebuild(index, out);
+    return true;
+}
+
+void historyPop(void) {
+    if (gCount == 0) return;
+    freeRecord(recordAt(gCount - 1));
+    gCount--;
+    gSinceKeyframe = 0;
+    for (int i = gCount - 1; i >= 0 && !recordAt(i)->keyframe; i--)
+        gSinceKeyframe++;
+    if (gCount > 0) rebuild(gCount - 1, &gNewest);
+    else memset(&gNewest, 0, sizeof(gNewest));
+    // A rewind across a scene boundary carries on in the run the newest entry belongs to
+    if (gCount > 0) {
+        GlobalsSnapshot *globals = retainGlobals(recordAt(gCount - 1)->globals);
+        releaseGlobals(gGlobals);
+        gGlobals = globals;
+    }
+}
+
+void historyClear(void) {
+    while (gCount > 0) freeOldest();
+    gHead = 0;
+    gSinceKeyframe = 0;
+    memset(&gNewest, 0, sizeof(gNewest));
+    releaseGlobals(gGlobals);
+    gGlobals = NULL;
+}
+
+void historyBeginScene(const unsigned char *globals, size_t size) {
+    GlobalsSnapshot *snapshot = globals ? malloc(sizeof(GlobalsSnapshot) + size) : NULL;
+    if (snapshot) {
+        snapshot->refs = 1;
+        snapshot->size = size;
+        memcpy(snapshot->data, globals, size);
+        gGlobalsBytes += sizeof(GlobalsSnapshot) + size;
+    }
+    releaseGlobals(gGlobals);
+    gGlobals = snapshot;
+}
+
+bool historyGlobals(int index, const unsigned char **data, size_t *size) {
+    if (index < 0 || index >= gCount || !recordAt(index)->globals) return false;
+    *data = recordAt(index)->globals->data;
+    *size = recordAt(index)->globals->size;
+    return true;
+}
+
+size_t historyEncode(const HistoryFrame *frame, unsigned char *buf, size_t capacity) {
+    Writer w = { buf, 0, capacity };
+    encode(&w, frame, NULL);
+    return w.len < capacity ? w.len : 0;
+}
+
+bool historyDecode(const unsigned char *data, size_t size, HistoryFrame *out) {
+    memset(out, 0, sizeof(HistoryFrame));
+    return decode(data, size, out);
+}
+
+HistoryStats historyGetStats(void) {
+    HistoryStats stats = { 0 };
+    stats.transitions = gTransitions;
+    stats.count = gCount;
+    stats.bytes = gRecordBytes + gGlobalsBytes + gCount * sizeof(HistoryRecord);
+    for (int i = 0; i < gCount; i++)
+        if (recordAt(i)->keyframe) stats.keyframes++;
+    return stats;
+}
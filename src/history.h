@@ -0,0 +1,66 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+#include <stddef.h>
+#include <stdbool.h>
+#include <raylib.h>
+
+#define HISTORY_CAPACITY 512   // transitions kept, oldest keyframe groups are dropped first
+#define HISTORY_KEYFRAME 32    // every Nth transition is stored in full
+#define HISTORY_MAX_SPRITES 32
+#define HISTORY_MAX_CHOICES 10
+
+// Script visible state at a transition, every string is an interned id (see intern.h)
+typedef struct {
+    int file;
+    int id;
+    Vector2 pos;
+} HistorySprite;
+
+typedef struct {
+    int text;
+    int scene;
+} HistoryChoice;
+
+typedef struct {
+    int scene;
+    int lastScene;
+    int script; // path the scene was loaded from
+    int line;   // yields into the scene, the resumes needed to get back here
+    int background;
+    int music;
+    int spriteCount;
+    HistorySprite sprites[HISTORY_MAX_SPRITES];
+    bool hasDialog;
+    int dialogName;
+    int dialogText;
+    Color dialogNameColor;
+    Color textColor;
+    bool dialogHasPos;
+    Vector2 dialogPos;
+    int choiceCount;
+    HistoryChoice choices[HISTORY_MAX_CHOICES];
+} HistoryFrame;
+
+typedef struct {
+    unsigned long transitions; // pushed over the whole session
+    int count;                 // currently held
+    size_t bytes;              // encoded records, globals snapshots and ring bookkeeping
+    int keyframes;
+} HistoryStats;
+
+extern void historyPush(const HistoryFrame *frame);
+extern int historyCount(void);
+// Rebuild entry index, 0 is the oldest held, historyCount() - 1 the newest
+extern bool historyGet(int index, HistoryFrame *out);
+// Forget the newest entry
+extern void historyPop(void);
+extern void historyClear(void);
+// Entries pushed from now on belong to a new scene run that started with these script globals (see savegame.h)
+extern void historyBeginScene(const unsigned char *globals, size_t size);
+// The globals the run of an entry started with, false when none were kept
+extern bool historyGlobals(int index, const unsigned char **data, size_t *size);
+// A frame on its own as a keyframe record, for keeping outside the ring, 0 when it does not fit in capacity
+extern size_t historyEncode(const HistoryFrame *frame, unsigned char *buf, size_t capacity);
+extern bool historyDecode(const unsigned char *data, size_t size, HistoryFrame *out);
+extern HistoryStats historyGetStats(void);
+#endif
@@ -0,0 +1,95 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../external/cc.h"
+#include "intern.h"
+
+static map(char *, int) gIds;
+static vec(char *) gStrings; // index is the id, slot 0 stays empty, NULL once collected
+static vec(int) gRefs;       // holders of each id
+static vec(int) gFreeIds;    // collected slots, handed out again before the table grows
+static size_t gBytes = 0;
+static bool gInternInit = false;
+
+static size_t entryBytes(const char *str) {
+    return strlen(str) + 1 + sizeof(char *) + 2 * sizeof(int);
+}
+
+int internString(const char *str) {
+    if (!str || !str[0]) return 0;
+    if (!gInternInit) {
+        init(&gIds);
+        init(&gStrings);
+        init(&gRefs);
+        init(&gFreeIds);
+        push(&gStrings, NULL);
+        push(&gRefs, 0);
+        gInternInit = true;
+    }
+    int *id = get(&gIds, (char *)str);
+    if (id) return *id;
+    char *copy = strdup(str);
+    if (!copy) return 0;
+    int next;
+    if (size(&gFreeIds) > 0) {
+        next = *last(&gFreeIds);
+        erase(&gFreeIds, size(&gFreeIds) - 1);
+        *get(&gStrings, next) = copy;
+    } else {
+        next = (int)size(&gStrings);
+        push(&gStrings, copy);
+        push(&gRefs, 0);
+    }
+    insert(&gIds, copy, next);
+    gBytes += entryBytes(copy);
+    return next;
+}
+
+const char *internLookup(int id) {
+    if (!gInternInit || id <= 0 || (size_t)id >= size(&gStrings)) return "";
+    char *str = *get(&gStrings, id);
+    return str ? str : "";
+}
+
+void internRetain(int id) {
+    if (!gInternInit || id <= 0 || (size_t)id >= size(&gRefs)) return;
+    (*get(&gRefs, id))++;
+}
+
+void internRelease(int id) {
+    if (!gInternInit || id <= 0 || (size_t)id >= size(&gRefs)) return;
+    int *refs = get(&gRefs, id);
+    if (*refs > 0) (*refs)--;
+}
+
+void internCollect(void) {
+    if (!gInternInit) return;
+    for (size_t id = 1; id < size(&gStrings); id++) {
+        char **str = get(&gStrings, id);
+        if (!*str || *get(&gRefs, id) > 0) continue;
+        erase(&gIds, *str);
+        gBytes -= entryBytes(*str);
+        free(*str);
+        *str = NULL;
+        push(&gFreeIds, (int)id);
+    }
+}
+
+int internCount(void) {
+    return gInternInit ? (int)(size(&gStrings) - 1 - size(&gFreeIds)) : 0;
+}
+
+size_t internBytes(void) {
+    return gBytes;
+}
+
+void internClear(void) {
+    if (!gInternInit) return;
+    gInternInit = false;
+    for_each(&gStrings, str) free(*str);
+    cleanup(&gStrings);
+    cleanup(&gRefs);
+    cleanup(&gFreeIds);
+    cleanup(&gIds);
+    gBytes = 0;
+}
@@ -0,0 +1,17 @@
+#ifndef INTERN_H
+#define INTERN_H
+#include <stddef.h>
+
+// Map a string to a small stable id, 0 is reserved for "none" and the empty string
+// An id kept past the next internCollect has to be retained, its slot may be given to another string otherwise
+extern int internString(const char *str);
+extern const char *internLookup(int id);
+extern void internRetain(int id);
+extern void internRelease(int id);
+// Free every string nobody retains
+extern void internCollect(void);
+extern int internCount(void);
+// Bytes held by the table itself, strings included
+extern size_t internBytes(void);
+extern void internClear(void);
+#endif
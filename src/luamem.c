@@ -0,0 +1,197 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <raylib.h>
+#include "luamem.h"
+
+#define POOL_CLASSES 8
+#define SLAB_HEADER 16 // keeps blocks 16 byte aligned
+
+// Sized for Lua's strings, tables, closures and upvalues
+static const size_t gClassSize[POOL_CLASSES] = { 16, 32, 48, 64, 96, 128, 192, 256 };
+static signed char gClassOf[LUA_POOL_MAX / 16 + 1]; // size rounded up to 16, divided by 16
+static bool gClassesBuilt = false;
+
+typedef struct PoolBlock {
+    struct PoolBlock *next;
+} PoolBlock;
+
+typedef struct PoolSlab {
+    struct PoolSlab *next;
+} PoolSlab;
+
+static PoolBlock *gFree[POOL_CLASSES];
+static PoolSlab *gSlabs = NULL;
+static uintptr_t *gSlabStarts = NULL; // sorted, tells pooled blocks from malloc'd ones
+static size_t gSlabCount = 0;
+static size_t gSlabCapacity = 0;
+static size_t gStepBytes = 0;        // allocated since the last collection
+static unsigned long gFrameAllocations = 0; // in the running frame, moved into gStats when it ends
+static LuaMemStats gStats;
+
+static void initClasses(void) {
+    if (gClassesBuilt) return;
+    for (size_t i = 1; i <= LUA_POOL_MAX / 16; i++) {
+        int c = 0;
+        while (gClassSize[c] < i * 16) c++;
+        gClassOf[i] = (signed char)c;
+    }
+    gClassesBuilt = true;
+}
+
+static inline int classOf(size_t size) {
+    return size <= LUA_POOL_MAX ? gClassOf[(size + 15) / 16] : -1;
+}
+
+static bool inSlab(const void *ptr) {
+    uintptr_t addr = (uintptr_t)ptr;
+    size_t lo = 0, hi = gSlabCount;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (gSlabStarts[mid] <= addr) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo > 0 && addr < gSlabStarts[lo - 1] + LUA_POOL_SLAB;
+}
+
+static bool addSlab(int c) {
+    if (gSlabCount == gSlabCapacity) {
+        size_t capacity = gSlabCapacity ? gSlabCapacity * 2 : 64;
+        uintptr_t *starts = realloc(gSlabStarts, capacity * sizeof(uintptr_t));
+        if (!starts) return false;
+        gSlabStarts = starts;
+        gSlabCapacity = capacity;
+    }
+    PoolSlab *slab = malloc(LUA_POOL_SLAB);
+    if (!slab) return false;
+    slab->next = gSlabs;
+    gSlabs = slab;
+
+    uintptr_t start = (uintptr_t)slab;
+    size_t at = gSlabCount;
+    while (at > 0 && gSlabStarts[at - 1] > start) at--;
+    memmove(&gSlabStarts[at + 1], &gSlabStarts[at], (gSlabCount - at) * sizeof(uintptr_t));
+    gSlabStarts[at] = start;
+    gSlabCount++;
+
+    size_t size = gClassSize[c];
+    for (char *block = (char *)slab + SLAB_HEADER; block + size <= (char *)slab + LUA_POOL_SLAB; block += size) {
+        PoolBlock *free = (PoolBlock *)block;
+        free->next = gFree[c];
+        gFree[c] = free;
+    }
+    gStats.pooled += LUA_POOL_SLAB;
+    return true;
+}
+
+static void *takeBlock(int c) {
+    if (!gFree[c] && !addSlab(c)) return NULL;
+    PoolBlock *block = gFree[c];
+    gFree[c] = block->next;
+    return block;
+}
+
+// A pooled block kept in place by a shrink goes back to the smaller class, which it still fits
+static void release(void *ptr, size_t osize) {
+    if (inSlab(ptr)) {
+        int c = classOf(osize);
+        PoolBlock *block = ptr;
+        block->next = gFree[c];
+        gFree[c] = block;
+    } else {
+        free(ptr);
+    }
+}
+
+static void *poolAlloc(void *ud, void *ptr, size_t osize, size_t nsize) {
+    (void)ud;
+    if (!ptr) osize = 0; // Lua passes the object type for new blocks
+    if (nsize == 0) {
+        if (ptr) release(ptr, osize);
+        gStats.live -= osize;
+        return NULL;
+    }
+    int newClass = classOf(nsize);
+    if (ptr && newClass >= 0 && classOf(osize) == newClass) {
+        gStats.live += nsize - osize;
+        return ptr;
+    }
+    if (ptr && newClass < 0 && osize > LUA_POOL_MAX && !inSlab(ptr)) {
+        void *block = realloc(ptr, nsize);
+        if (!block) return nsize <= osize ? ptr : NULL;
+        gStats.live += nsize - osize;
+        return block;
+    }
+
+    void *block = newClass >= 0 ? takeBlock(newClass) : malloc(nsize);
+    if (!block) {
+        // Lua relies on shrinking never failing, the old block is big enough
+        if (ptr && nsize <= osize) {
+            gStats.live -= osize - nsize;
+            return ptr;
+        }
+        return NULL;
+    }
+    if (ptr) {
+        memcpy(block, ptr, osize < nsize ? osize : nsize);
+        release(ptr, osize);
+    }
+    gStats.live += nsize - osize;
+    gStats.allocations++;
+    gFrameAllocations++;
+    if (nsize > osize) gStepBytes += nsize - osize;
+    return block;
+}
+
+static int panic(lua_State *L) {
+    const char *message = lua_tostring(L, -1);
+    TraceLog(LOG_ERROR, "Lua panic: %s", message ? message : "error object is not a string");
+    return 0;
+}
+
+lua_State *luaMemNewState(void) {
+    initClasses();
+    lua_State *L = lua_newstate(poolAlloc, NULL);
+    if (!L) return NULL;
+    lua_atpanic(L, panic);
+    lua_gc(L, LUA_GCGEN, LUA_GC_MINOR_MUL, 0);
+    return L;
+}
+
+void luaMemEndFrame(lua_State *L, bool transition) {
+    double start = GetTime();
+    if (transition) {
+        lua_gc(L, LUA_GCCOLLECT);
+        gStats.collections++;
+        gStepBytes = 0;
+    } else if (gStepBytes >= LUA_GC_STEP_BYTES) {
+        // A young collection in generational mode, paid for now instead of inside the next script call
+        lua_gc(L, LUA_GCSTEP, 0);
+        gStats.steps++;
+        gStepBytes = 0;
+    }
+    gStats.frameGcTime = GetTime() - start;
+    if (gStats.frameGcTime > gStats.maxGcTime) gStats.maxGcTime = gStats.frameGcTime;
+    gStats.frameAllocations = gFrameAllocations;
+    gFrameAllocations = 0;
+}
+
+void luaMemShutdown(void) {
+    while (gSlabs) {
+        PoolSlab *next = gSlabs->next;
+        free(gSlabs);
+        gSlabs = next;
+    }
+    free(gSlabStarts);
+    gSlabStarts = NULL;
+    gSlabCount = gSlabCapacity = 0;
+    memset(gFree, 0, sizeof(gFree));
+    gStats.pooled = 0;
+    gStepBytes = 0;
+    gFrameAllocations = 0;
+}
+
+LuaMemStats luaMemGetStats(void) {
+    return gStats;
+}
@@ -0,0 +1,30 @@
+#ifndef LUAMEM_H
+#define LUAMEM_H
+#include <stdbool.h>
+#include <stddef.h>
+#include "../build/lua/lua.h"
+
+#define LUA_POOL_MAX 256          // larger blocks go straight to malloc
+#define LUA_POOL_SLAB 65536       // bytes carved into blocks of one size class at a time
+#define LUA_GC_STEP_BYTES 65536   // allocated since the last step before a frame pays for another
+#define LUA_GC_MINOR_MUL 100      // young collections only start mid frame once the heap has doubled
+
+typedef struct {
+    unsigned long allocations;      // blocks handed out over the session
+    unsigned long frameAllocations; // in the last finished frame
+    size_t live;                    // bytes Lua holds
+    size_t pooled;                  // bytes of slabs backing the small size classes
+    unsigned long steps;
+    unsigned long collections;      // full collections on transition frames
+    double frameGcTime;             // seconds of collection in the last frame
+    double maxGcTime;
+} LuaMemStats;
+
+// A state using the pooled allocator with the collector in generational mode
+extern lua_State *luaMemNewState(void);
+// Called once the frame is presented, a full collection when the scene changed, otherwise a step if enough was allocated
+extern void luaMemEndFrame(lua_State *L, bool transition);
+// Free the pools, only after the state is closed
+extern void luaMemShutdown(void);
+extern LuaMemStats luaMemGetStats(void);
+#endif
@@ -1,26 +1,56 @@
 #include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
 #include <strings.h>
+#include <time.h>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
 #include "raylib.h"
 #define RAYGUI_IMPLEMENTATION
 #include "../external/raygui.h"
 #include "../external/cc.h"
-#include "boundedtext.h"
+#include "textlayout.h"
+#include "glyphatlas.h"
+#include "assetloader.h"
+#include "assetcache.h"
+#include "scenegraph.h"
+#include "intern.h"
+#include "history.h"
+#include "sfx.h"
+#include "music.h"
+#include "scriptcache.h"
+#include "coroutines.h"
+#include "luamem.h"
+#include "commandqueue.h"
+#include "pack.h"
+#include "texcache.h"
+#include "resample.h"
+#include "watcher.h"
+#include "savegame.h"
+#ifdef VN_HEADLESS
+#include "headless.h"
+#endif
 #include "../build/lua/lua.h"
 #include "../build/lua/lualib.h"
 #include "../build/lua/lauxlib.h"
 
-#define GLSL_VERSION 330
 
 #define PATH_BUFFER_SIZE 512
 #define BUFFER_SIZE 256
-#define CACHE_SIZE 32
+#define MAX_SPRITES 32
 #define MAX_CHOICES 10
+#define DIALOG_FONT_SIZE 20
+#define DIALOG_DESIGN_HEIGHT 450.0f // module fonts scale with the window from this height
+#define RUN_AHEAD_LINES 3 // lines a scene is executed ahead of the player
+#define STAGE_COMMANDS 16 // engine calls a choice target may make before its first line while staged
+#define SCENE_ENV_KEY "vn.sceneenv" // registry proxy scenes see as their globals
 
 typedef struct {
-    Texture2D texture;
+    AssetHandle *texture;
     Vector2 pos;
     char id[BUFFER_SIZE];
     bool hasID;
@@ -37,17 +67,10 @@ float masterVolume = 1.0;
 float soundVolume = 1.0;
 float musicVolume = 1.0;
 
-omap(char *, Texture2D) backgroundCache;
-omap(char *, Music)     musicCache;
-omap(char *, Texture2D) spriteCache;
-list(char *) backgroundLRU;
-list(char *) musicLRU;
-list(char *) spriteLRU;
-
 typedef struct {
-    Texture2D background;
-    Music music;
-    Sprite sprites[CACHE_SIZE];
+    AssetHandle *background;
+    AssetHandle *nextBackground; // still decoding, background stays on screen until it is ready
+    Sprite sprites[MAX_SPRITES];
     int spriteCount;
     int screenWidth; 
     int screenHeight;
@@ -67,7 +90,8 @@ typedef struct {
     const char* moduleFolder;
     char bgfile[PATH_BUFFER_SIZE];
     char musicfile[PATH_BUFFER_SIZE];
-    char spritefiles[CACHE_SIZE][PATH_BUFFER_SIZE];
+    char fontfile[PATH_BUFFER_SIZE];
+    char spritefiles[MAX_SPRITES][PATH_BUFFER_SIZE];
 } GameState;
 
 static GameState gGameState = {
@@ -86,12 +110,34 @@ static GameState gGameState = {
     .moduleFolder = "",
     .bgfile = "",
     .musicfile = "",
+    .fontfile = "",
     .spritefiles = ""
 };
 
-vec(GameState) gameStateStack;
+_Static_assert(MAX_SPRITES <= HISTORY_MAX_SPRITES && MAX_CHOICES <= HISTORY_MAX_CHOICES,
+               "history frames must hold every sprite and choice");
+_Static_assert(MAX_CHOICES <= COMMAND_MAX_CHOICES, "queued commands must hold every choice");
+
+typedef struct {
+    int draws; // textured quads issued for the scene
+    int binds; // texture changes between them, each one ends an rlgl batch
+} RenderStats;
+
+static RenderStats gRenderStats = { 0 };
+static RenderStats gFrameRenderStats = { 0 }; // totals of the last composition
+static unsigned int gBoundTexture = 0;
+
+// Background, sprites and dialog are drawn into gSceneTarget only when their signature changes
+static RenderTexture2D gSceneTarget = { 0 };
+static uint64_t gSceneSignature = 0;
+static bool gSceneStale = true;
+static unsigned long gSceneRebuilds = 0;
+static bool gIdle = false; // waiting on input events instead of polling every frame
+
 static lua_State *gL = NULL;
 static lua_State *gSceneThread = NULL;
+static unsigned long gSceneLoads = 0; // scene transitions over the session, rollbacks included
+static double gResumeTime = 0; // seconds spent inside scene code
 
 enum {
     MODULE,
@@ -111,145 +157,903 @@ enum {
 /* Exposed Variables */
 static char gCurrentScene[BUFFER_SIZE] = "";
 static char gLastScene[BUFFER_SIZE] = "";
+static char gScenePath[PATH_BUFFER_SIZE] = "";
+static int gSceneLine = 0;      // yields reached in the running scene
+static bool gReplaying = false; // fast forwarding a scene to a checkpoint, engine calls have no effect
+static lua_State *gAheadThread = NULL; // being resumed ahead of the player, its engine calls are queued instead of applied
+static bool gAheadStopped = false; // the scene waits at a call that has to run live, or after its choices
+static bool gSceneEnded = false;   // returned or failed, nothing is left to resume
+static unsigned long gAheadStops = 0;
+static bool gHotReload = false;    // VN_HOT_RELOAD, edited module files are reloaded while the engine runs
+static bool gHotRestart = false;   // and an edited scene is run again up to the line on screen
+static unsigned long gSceneErrors = 0; // scenes that failed to load or stopped on an error, a soak run with any fails
+
+// Assignments to globals a scene made ahead of the player, _G only gets each one once the player reaches it
+typedef struct {
+    int shadow;  // registry ref, name to latest value for the scene's own reads, LUA_NOREF until the first assignment
+    int pending; // registry ref, key and value of every assignment by slot
+    int issued;  // slots handed out, the table refs are dropped once all of them are applied
+    int applied;
+} AheadGlobals;
 
-static void updateLRU(list(char *) *lruList, const char *key) {
-    for_each(lruList, el) {
-        if (strcmp(*el, key) == 0) {
-            erase(lruList, el);
-            break;
-        }
+#define NO_AHEAD_GLOBALS ((AheadGlobals){ LUA_NOREF, LUA_NOREF, 0, 0 })
+
+// A choice target run up to its first line while the menu is up, taken over as is when the choice is made
+typedef struct {
+    char scene[BUFFER_SIZE];
+    lua_State *thread; // NULL when it failed to load or run, the choice then loads the scene as usual
+    SceneCommand commands[STAGE_COMMANDS];
+    int commandCount;
+    int assets; // images its commands name, requested then unless already resident or on their way
+    AheadGlobals globals;
+    bool stopped;
+    bool ended;
+    bool failed; // made more calls than it holds where it could not stop, given up once its resume returns
+} StagedScene;
+
+static StagedScene gStaged[MAX_CHOICES];
+static int gStagedCount = 0;
+static StagedScene *gStaging = NULL; // being resumed, engine calls go into its commands
+static int gHoveredChoice = -1;
+static unsigned long gStagedHits = 0;  // choices taken whose staged scene had queued anything
+static unsigned long gStagedCommands = 0;
+static unsigned long gStagedAssets = 0;
+static AheadGlobals gAheadGlobals = { LUA_NOREF, LUA_NOREF, 0, 0 }; // held back for the running scene
+static char gNilGlobal;              // stands in a shadow for a global assigned nil
+static bool gSceneIndexShadow = false; // the proxy's __index is l_scene_index rather than _G
+static double gChoiceTime = 0;     // when the last choice was taken, until its first frame is presented
+static bool gChoiceStaged = false;
+static double gChoiceLatency = 0;  // seconds from the last choice to its first frame
+
+// Sized for another screen height and would come out at a different size now, the old texture is drawn until it is replaced
+static void refreshTexture(AssetKind kind, AssetHandle *handle) {
+    if (!assetReady(handle)) return;
+    int target = assetLoaderTarget();
+    if (assetTarget(handle) == target) return;
+    int height = assetLoaderFitHeight(kind, (int)assetSize(handle).y, target);
+    if (height != (int)assetSource(handle).height) assetLoaderRequest(kind, assetPath(handle));
+}
+
+// Main thread side of the asset pipeline, handles already held on the path see the texture directly
+static void onAssetReady(AssetKind kind, const char *path, AssetImage decoded) {
+    gSceneStale = true;
+    int width = decoded.image.width, height = decoded.image.height;
+    AssetHandle *handle = assetCacheFill(kind, path, decoded);
+    if (!handle) return;
+    TraceLog(LOG_INFO, "Uploaded %s: %s (%dx%d of %dx%d)", kind == ASSET_BACKGROUND ? "background" : "sprite", path,
+             width, height, decoded.sourceWidth, decoded.sourceHeight);
+    // Decoded while the screen was resized
+    refreshTexture(kind, handle);
+}
+
+// Images are sized for the screen height when they are decoded, on a resize only what is on screen is redone
+static void updateAssetTarget(void) {
+    int height = GetScreenHeight();
+    if (height == assetLoaderTarget()) return;
+    assetLoaderSetTarget(height);
+    refreshTexture(ASSET_BACKGROUND, gGameState.background);
+    for (int i = 0; i < gGameState.spriteCount; i++)
+        refreshTexture(ASSET_SPRITE, gGameState.sprites[i].texture);
+}
+
+static AssetHandle *acquireTexture(AssetKind kind, const char *path) {
+    AssetHandle *handle = assetCacheAcquire(kind, path);
+    if (handle) {
+        // Cached for an earlier screen size, the rest of the cache is redone as scenes use it
+        refreshTexture(kind, handle);
+        return handle;
     }
-    insert(lruList, first(lruList), (char *)key);
+    handle = assetRetain(assetCacheReserve(kind, path));
+    assetLoaderRequest(kind, path);
+    return handle;
 }
 
-void cachePrefetched(const char *funcName, const char *path) {
-    if (strcmp(funcName, "load_background") == 0) {
-        Texture2D *cached = get(&backgroundCache, path);
-        if (!cached) {
-            Texture2D tex = LoadTexture(path);
-            char *key = strdup(path);
-            insert(&backgroundCache, key, tex);
-            TraceLog(LOG_INFO, "Cached background: %s", path);
-        }
-    } else if (strcmp(funcName, "load_sprite") == 0) {
-        Texture2D *cached = get(&spriteCache, path);
-        if (!cached) {
-            Texture2D tex = LoadTexture(path);
-            char *key = strdup(path);
-            insert(&spriteCache, key, tex);
-            TraceLog(LOG_INFO, "Cached sprite: %s", path);
-        }
-    } else if (strcmp(funcName, "load_music") == 0) {
-        Music *cached = get(&musicCache, path);
-        if (!cached) {
-            Music music = LoadMusicStream(path);
-            char *key = strdup(path);
-            insert(&musicCache, key, music);
-            TraceLog(LOG_INFO, "Cached music: %s", path);
+static void presentNextBackground(void) {
+    if (!assetReady(gGameState.nextBackground)) return;
+    assetRelease(gGameState.background);
+    gGameState.background = gGameState.nextBackground;
+    gGameState.nextBackground = NULL;
+    gGameState.hasBackground = true;
+}
+
+// Give back every handle the scene holds, the cache keeps them resident until evicted
+static void releaseSceneAssets(void) {
+    musicStop();
+    assetRelease(gGameState.background);
+    assetRelease(gGameState.nextBackground);
+    for (int i = 0; i < gGameState.spriteCount; i++)
+        assetRelease(gGameState.sprites[i].texture);
+    gGameState.background = NULL;
+    gGameState.nextBackground = NULL;
+    gGameState.hasMusic = false;
+    gGameState.hasBackground = false;
+    gGameState.spriteCount = 0;
+}
+
+// Checkpoints only keep interned names, handles belong to the live state
+static void pushCheckpoint(void) {
+    HistoryFrame frame = { 0 };
+    frame.scene = internString(gCurrentScene);
+    frame.lastScene = internString(gLastScene);
+    frame.script = internString(gScenePath);
+    frame.line = gSceneLine;
+    if (gGameState.background || gGameState.nextBackground) frame.background = internString(gGameState.bgfile);
+    if (gGameState.hasMusic) frame.music = internString(gGameState.musicfile);
+    frame.spriteCount = gGameState.spriteCount;
+    for (int i = 0; i < gGameState.spriteCount; i++) {
+        frame.sprites[i].file = internString(gGameState.spritefiles[i]);
+        frame.sprites[i].id = gGameState.sprites[i].hasID ? internString(gGameState.sprites[i].id) : 0;
+        frame.sprites[i].pos = gGameState.sprites[i].pos;
+    }
+    frame.hasDialog = gGameState.hasDialog;
+    frame.dialogName = internString(gGameState.dialogName);
+    frame.dialogText = internString(gGameState.dialogText);
+    frame.dialogNameColor = gGameState.dialogNameColor;
+    frame.textColor = gGameState.textColor;
+    frame.dialogHasPos = gGameState.dialogHasPos;
+    frame.dialogPos = gGameState.dialogPos;
+    frame.choiceCount = gGameState.choiceCount;
+    for (int i = 0; i < gGameState.choiceCount; i++) {
+        frame.choices[i].text = internString(gGameState.choices[i].text);
+        frame.choices[i].scene = internString(gGameState.choices[i].scene);
+    }
+    historyPush(&frame);
+}
+
+// Entries pushed from here on replay from the globals as they are now, the new scene has not run a line yet
+static void beginSceneRun(void) {
+    size_t size;
+    unsigned char *globals = saveGameEncodeGlobals(gL, &size);
+    historyBeginScene(globals, size);
+    free(globals);
+}
+
+static void logHistoryStats(void) {
+    HistoryStats stats = historyGetStats();
+    if (stats.count == 0) return;
+    size_t bytes = stats.bytes + internBytes();
+    TraceLog(LOG_INFO, "History: %d of %lu transitions held in %zu bytes (%zu per transition, a full GameState is %zu)",
+             stats.count, stats.transitions, bytes, bytes / stats.count, sizeof(GameState));
+}
+
+// Start decoding a texture that is neither cached nor on its way, nothing holds it until a scene acquires it
+static void prefetchTexture(AssetKind kind, const char *path) {
+    if (gStaging) gStaging->assets++;
+    if (assetCacheHas(kind, path) || assetLoaderPending(kind, path)) return;
+    assetLoaderRequest(kind, path);
+    TraceLog(LOG_INFO, "Prefetching %s: %s", kind == ASSET_BACKGROUND ? "background" : "sprite", path);
+}
+
+// Queue an asset from the scene graph so it is resident before the scene that uses it runs
+static void warmAsset(SceneAssetKind kind, const char *file) {
+    // Back at an entry script, image paths only resolve once its module_init has run
+    if (gGameState.moduleFolder[0] == '\0') return;
+    char path[PATH_BUFFER_SIZE];
+    switch (kind) {
+        case SCENE_BACKGROUND: {
+            snprintf(path, PATH_BUFFER_SIZE, "mods/%s/images/%s", gGameState.moduleFolder, file);
+            prefetchTexture(ASSET_BACKGROUND, path);
+        } break;
+        case SCENE_SPRITE: {
+            snprintf(path, PATH_BUFFER_SIZE, "mods/%s/images/%s", gGameState.moduleFolder, file);
+            prefetchTexture(ASSET_SPRITE, path);
+        } break;
+        case SCENE_MUSIC: {
+            // Streams are opened when played, music.c never keeps more than two decoders open
+        } break;
+    }
+}
+
+static int resumeTimed(lua_State *thread) {
+    int nres = 0;
+    double start = GetTime();
+    int status = lua_resume(thread, gL, 0, &nres);
+    gResumeTime += GetTime() - start;
+    return status;
+}
+
+// Logged on stderr, where a script author looks for them, and counted for the soak runs
+static void reportSceneError(const char *what, lua_State *thread) {
+    fprintf(stderr, "Error %s scene: %s\n", what, lua_tostring(thread, -1));
+    gSceneErrors++;
+}
+
+// Every yield of the running scene is a line the back button can return to
+static void resumeScene(lua_State *thread) {
+    int status = resumeTimed(thread);
+    if (status != LUA_YIELD && status != LUA_OK) reportSceneError("running", thread);
+    // A script that called pop_state has already been replaced by the restarted scene
+    if (thread != gSceneThread) return;
+    if (status == LUA_YIELD) {
+        gSceneLine++;
+        pushCheckpoint();
+    } else {
+        gSceneEnded = true;
+    }
+}
+
+static void setBackground(const char *path) {
+    strncpy(gGameState.bgfile, path, PATH_BUFFER_SIZE - 1);
+    AssetHandle *bg = acquireTexture(ASSET_BACKGROUND, path);
+    assetRelease(gGameState.nextBackground);
+    gGameState.nextBackground = NULL;
+    if (assetReady(bg) || !gGameState.hasBackground) {
+        assetRelease(gGameState.background);
+        gGameState.background = bg;
+        gGameState.hasBackground = true;
+    } else {
+        // The previous background stays on screen until presentNextBackground swaps this one in
+        gGameState.nextBackground = bg;
+    }
+}
+
+static bool setMusic(const char *path, float start) {
+    if (!musicPlay(path, start)) return false;
+    strncpy(gGameState.musicfile, path, PATH_BUFFER_SIZE - 1);
+    gGameState.hasMusic = true;
+    return true;
+}
+
+// Push a scene's main function with the globals proxy as its _ENV
+static int loadSceneChunk(lua_State *thread, const char *path) {
+    if (scriptCacheLoad(thread, path) != LUA_OK) return LUA_ERRFILE;
+    lua_getfield(thread, LUA_REGISTRYINDEX, SCENE_ENV_KEY);
+    if (!lua_setupvalue(thread, -2, 1)) lua_pop(thread, 1);
+    return LUA_OK;
+}
+
+// Reads from a scene running ahead see its own held back assignments first, _G after that
+static int l_scene_index(lua_State *L) {
+    AheadGlobals *globals = gStaging ? &gStaging->globals : &gAheadGlobals;
+    if (gAheadThread && globals->shadow != LUA_NOREF) {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, globals->shadow);
+        lua_pushvalue(L, 2);
+        if (lua_rawget(L, -2) != LUA_TNIL) {
+            if (lua_touserdata(L, -1) == &gNilGlobal) lua_pushnil(L);
+            return 1;
         }
     }
+    lua_pushglobaltable(L);
+    lua_pushvalue(L, 2);
+    lua_gettable(L, -2);
+    return 1;
 }
 
-void prefetchAssets(lua_State *L) {
-    if (!L) return;
-    lua_Debug ar;
-    int level = 0;
-    while (lua_getstack(L, level, &ar)) {
-        if (lua_getinfo(L, "nSl", &ar) == 0)
-            break;
-        if (ar.name && (strcmp(ar.name, "load_background") == 0 ||
-                        strcmp(ar.name, "load_sprite") == 0 ||
-                        strcmp(ar.name, "load_music") == 0)) {
-            if (lua_getlocal(L, &ar, 1) != NULL && lua_isstring(L, -1)) {
-                const char *assetPath = lua_tostring(L, -1);
-                cachePrefetched(ar.name, assetPath);
+// The proxy reads straight through to _G unless some scene holds assignments back
+static void refreshSceneIndex(void) {
+    bool shadow = gAheadGlobals.shadow != LUA_NOREF;
+    for (int i = 0; i < gStagedCount; i++)
+        shadow = shadow || gStaged[i].globals.shadow != LUA_NOREF;
+    if (shadow == gSceneIndexShadow) return;
+    gSceneIndexShadow = shadow;
+    lua_getfield(gL, LUA_REGISTRYINDEX, SCENE_ENV_KEY);
+    lua_getmetatable(gL, -1);
+    if (shadow) lua_pushcfunction(gL, l_scene_index);
+    else lua_pushglobaltable(gL);
+    lua_setfield(gL, -2, "__index");
+    lua_pop(gL, 2);
+}
+
+static void dropGlobals(AheadGlobals *globals) {
+    bool shadow = globals->shadow != LUA_NOREF;
+    luaL_unref(gL, LUA_REGISTRYINDEX, globals->shadow);
+    luaL_unref(gL, LUA_REGISTRYINDEX, globals->pending);
+    *globals = NO_AHEAD_GLOBALS;
+    if (shadow) refreshSceneIndex();
+}
+
+// Hold back the assignment of the value at 3 to the key at 2, the scene reads it from the shadow meanwhile
+static void holdGlobal(lua_State *L, AheadGlobals *globals, int slot) {
+    if (globals->shadow == LUA_NOREF) {
+        lua_newtable(L);
+        globals->shadow = luaL_ref(L, LUA_REGISTRYINDEX);
+        lua_newtable(L);
+        globals->pending = luaL_ref(L, LUA_REGISTRYINDEX);
+        refreshSceneIndex();
+    }
+    globals->issued = slot;
+    lua_rawgeti(L, LUA_REGISTRYINDEX, globals->shadow);
+    lua_pushvalue(L, 2);
+    if (lua_isnil(L, 3)) lua_pushlightuserdata(L, &gNilGlobal);
+    else lua_pushvalue(L, 3);
+    lua_rawset(L, -3);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, globals->pending);
+    lua_pushvalue(L, 2);
+    lua_rawseti(L, -2, 2 * (lua_Integer)slot - 1);
+    lua_pushvalue(L, 3);
+    lua_rawseti(L, -2, 2 * (lua_Integer)slot);
+    lua_pop(L, 2);
+}
+
+// The player reached a held back assignment, raw since this runs outside the scene's protected call
+static void applyGlobal(int slot) {
+    AheadGlobals *globals = &gAheadGlobals;
+    if (globals->pending == LUA_NOREF) return;
+    lua_rawgeti(gL, LUA_REGISTRYINDEX, globals->pending);
+    lua_pushglobaltable(gL);
+    lua_rawgeti(gL, -2, 2 * (lua_Integer)slot - 1);
+    lua_rawgeti(gL, -3, 2 * (lua_Integer)slot);
+    lua_rawset(gL, -3);
+    lua_pushnil(gL);
+    lua_rawseti(gL, -3, 2 * (lua_Integer)slot - 1);
+    lua_pushnil(gL);
+    lua_rawseti(gL, -3, 2 * (lua_Integer)slot);
+    lua_pop(gL, 2);
+    if (++globals->applied == globals->issued) dropGlobals(globals);
+}
+
+// Queued calls and assignments the player will not reach
+static void clearAhead(void) {
+    commandQueueClear();
+    dropGlobals(&gAheadGlobals);
+}
+
+// What an engine call does once the player reaches it
+static void applyCommand(const SceneCommand *command) {
+    const char *path = internLookup(command->file);
+    switch (command->kind) {
+        case COMMAND_BACKGROUND: {
+            setBackground(path);
+            TraceLog(LOG_INFO, "%s background: %s", gGameState.nextBackground ? "Requested new" : "Loaded", GetFileName(path));
+        } break;
+        case COMMAND_SPRITE: {
+            if (gGameState.spriteCount >= MAX_SPRITES) break;
+            Sprite *sprite = &gGameState.sprites[gGameState.spriteCount];
+            // Not drawn until the texture has been uploaded
+            sprite->texture = acquireTexture(ASSET_SPRITE, path);
+            sprite->pos = command->pos;
+            sprite->hasID = command->id != 0;
+            strncpy(sprite->id, internLookup(command->id), BUFFER_SIZE - 1);
+            sprite->id[BUFFER_SIZE - 1] = '\0';
+            strncpy(gGameState.spritefiles[gGameState.spriteCount], path, PATH_BUFFER_SIZE - 1);
+            gGameState.spriteCount++;
+            TraceLog(LOG_INFO, "Loaded sprite: %s", GetFileName(path));
+        } break;
+        case COMMAND_UNLOAD_SPRITE: {
+            const char *id = internLookup(command->id);
+            for (int i = 0; i < gGameState.spriteCount; i++) {
+                if (gGameState.sprites[i].hasID && strcmp(gGameState.sprites[i].id, id) == 0) {
+                    assetRelease(gGameState.sprites[i].texture);
+                    for (int j = i; j < gGameState.spriteCount - 1; j++) {
+                        strncpy(gGameState.spritefiles[j], gGameState.spritefiles[j + 1], PATH_BUFFER_SIZE);
+                        gGameState.sprites[j] = gGameState.sprites[j + 1];
+                    }
+                    gGameState.spriteCount--;
+                    TraceLog(LOG_INFO, "Unloaded sprite with id: %s", id);
+                    break;
+                }
+            }
+        } break;
+        case COMMAND_FONT: {
+            if (glyphAtlasLoad(path)) strncpy(gGameState.fontfile, path, PATH_BUFFER_SIZE - 1);
+            else TraceLog(LOG_WARNING, "Failed to load font: %s", path);
+        } break;
+        case COMMAND_MUSIC: {
+            if (setMusic(path, command->start))
+                TraceLog(LOG_INFO, "Playing music: %s", GetFileName(path));
+        } break;
+        case COMMAND_SOUND: {
+            if (sfxPlay(path))
+                TraceLog(LOG_INFO, "Played sound: %s", GetFileName(path));
+        } break;
+        case COMMAND_TEXT: {
+            strncpy(gGameState.dialogName, internLookup(command->name), BUFFER_SIZE - 1);
+            gGameState.dialogName[BUFFER_SIZE - 1] = '\0';
+            strncpy(gGameState.dialogText, internLookup(command->text), BUFFER_SIZE - 1);
+            gGameState.dialogText[BUFFER_SIZE - 1] = '\0';
+            gGameState.dialogNameColor = command->nameColor;
+            gGameState.textColor = command->textColor;
+            gGameState.dialogHasPos = command->hasPos;
+            if (command->hasPos) gGameState.dialogPos = command->pos;
+            gGameState.hasDialog = true;
+            if (glyphAtlasActive()) {
+                glyphAtlasFont(gGameState.dialogName);
+                glyphAtlasFont(gGameState.dialogText);
+            }
+            TraceLog(LOG_INFO, "Show text: %s", gGameState.dialogText);
+        } break;
+        case COMMAND_CLEAR_TEXT: {
+            gGameState.dialogText[0] = '\0';
+            gGameState.dialogName[0] = '\0';
+            gGameState.hasDialog = false;
+            gGameState.dialogHasPos = false;
+        } break;
+        case COMMAND_CHOICES: {
+            gGameState.choiceCount = command->choiceCount;
+            for (int i = 0; i < command->choiceCount; i++) {
+                strncpy(gGameState.choices[i].text, internLookup(command->choices[i].text), BUFFER_SIZE - 1);
+                gGameState.choices[i].text[BUFFER_SIZE - 1] = '\0';
+                strncpy(gGameState.choices[i].scene, internLookup(command->choices[i].scene), BUFFER_SIZE - 1);
+                gGameState.choices[i].scene[BUFFER_SIZE - 1] = '\0';
+            }
+        } break;
+        case COMMAND_GLOBAL: {
+            applyGlobal(command->slot);
+        } break;
+    }
+}
+
+// Start on what a queued command will need, so it is ready by the time the player gets to it
+static void prefetchCommand(const SceneCommand *command) {
+    switch (command->kind) {
+        case COMMAND_BACKGROUND: {
+            prefetchTexture(ASSET_BACKGROUND, internLookup(command->file));
+        } break;
+        case COMMAND_SPRITE: {
+            prefetchTexture(ASSET_SPRITE, internLookup(command->file));
+        } break;
+        case COMMAND_TEXT: {
+            // Rasterized with the font in use now, a load_font queued before it means these are done again
+            if (glyphAtlasActive()) {
+                glyphAtlasFont(internLookup(command->name));
+                glyphAtlasFont(internLookup(command->text));
             }
-            lua_pop(L, 1); // pop the local variable
+        } break;
+        default: break;
+    }
+}
+
+// Resume the scene until it is RUN_AHEAD_LINES lines past the player, queuing its engine calls
+static void runAhead(void) {
+    lua_State *thread = gSceneThread;
+    while (thread && thread == gSceneThread && !gSceneEnded && !gAheadStopped &&
+           gGameState.choiceCount == 0 && commandQueueLines() < RUN_AHEAD_LINES) {
+        gAheadThread = thread;
+        int status = resumeTimed(thread);
+        gAheadThread = NULL;
+        if (status != LUA_YIELD) {
+            if (status != LUA_OK) reportSceneError("running", thread);
+            gSceneEnded = true;
         }
-        level++;
     }
 }
 
+// Show the next line, straight from the queue when the scene already ran ahead to it
+static void advanceScene(void) {
+    SceneCommand command;
+    bool lineEnded = false;
+    while (!lineEnded && commandQueuePop(&command)) {
+        applyCommand(&command);
+        lineEnded = command.kind == COMMAND_TEXT || command.kind == COMMAND_CHOICES;
+    }
+    if (lineEnded) {
+        gSceneLine++;
+        pushCheckpoint();
+    } else if (!gSceneEnded) {
+        // Run-ahead stopped short of the next line, the scene carries on live from where it waits
+        gAheadStopped = false;
+        resumeScene(gSceneThread);
+    }
+    runAhead();
+}
+
+static bool sceneCanAdvance(void) {
+    return commandQueueSize() > 0 || !gSceneEnded;
+}
+
+static StagedScene *findStaged(const char *sceneFile) {
+    for (int i = 0; i < gStagedCount; i++)
+        if (strcmp(gStaged[i].scene, sceneFile) == 0) return &gStaged[i];
+    return NULL;
+}
+
+// Choices that were not taken, their threads go back to the pool and their commands are dropped
+static void discardStaged(void) {
+    for (int i = 0; i < gStagedCount; i++) {
+        coroutineRelease(gStaged[i].thread);
+        for (int j = 0; j < gStaged[i].commandCount; j++)
+            commandRelease(&gStaged[i].commands[j]);
+        dropGlobals(&gStaged[i].globals);
+    }
+    gStagedCount = 0;
+}
+
+// Load a choice target and run it to its first line with its engine calls held back, only its images are requested
+static void stageScene(const char *sceneFile) {
+    if (gStagedCount == MAX_CHOICES) return;
+    StagedScene *stage = &gStaged[gStagedCount++];
+    strncpy(stage->scene, sceneFile, BUFFER_SIZE - 1);
+    stage->scene[BUFFER_SIZE - 1] = '\0';
+    stage->commandCount = 0;
+    stage->assets = 0;
+    stage->globals = NO_AHEAD_GLOBALS;
+    stage->stopped = false;
+    stage->ended = false;
+    stage->failed = false;
+
+    char path[PATH_BUFFER_SIZE];
+    snprintf(path, PATH_BUFFER_SIZE, "mods/%s/%s", gGameState.moduleFolder, sceneFile);
+    stage->thread = coroutineAcquire(gL);
+    if (loadSceneChunk(stage->thread, path) != LUA_OK) {
+        coroutineRelease(stage->thread);
+        stage->thread = NULL;
+        return;
+    }
+    // The scene sees the last_scene it will have once chosen
+    lua_pushstring(gL, gCurrentScene);
+    lua_setglobal(gL, "last_scene");
+    gStaging = stage;
+    gAheadThread = stage->thread;
+    int status = resumeTimed(stage->thread);
+    gAheadThread = NULL;
+    gStaging = NULL;
+    lua_pushstring(gL, gLastScene);
+    lua_setglobal(gL, "last_scene");
+    if (status == LUA_OK && !stage->failed) {
+        stage->ended = true;
+    } else if (status != LUA_YIELD || stage->failed) {
+        // Left for loadScene to run again and report, should it be chosen
+        coroutineRelease(stage->thread);
+        stage->thread = NULL;
+        dropGlobals(&stage->globals);
+    }
+}
+
+// Prepare one choice target per frame while the menu is up, the one under the mouse first
+static void stageChoices(int hovered) {
+    int next = -1;
+    if (hovered >= 0 && hovered < gGameState.choiceCount && !findStaged(gGameState.choices[hovered].scene))
+        next = hovered;
+    for (int i = 0; next < 0 && i < gGameState.choiceCount; i++)
+        if (!findStaged(gGameState.choices[i].scene)) next = i;
+    if (next >= 0) stageScene(gGameState.choices[next].scene);
+}
+
+static bool choicesUnstaged(void) {
+    for (int i = 0; i < gGameState.choiceCount; i++)
+        if (!findStaged(gGameState.choices[i].scene)) return true;
+    return false;
+}
+
 static void loadScene(const char *sceneFile) {
-    prefetchAssets(gSceneThread);
     strncpy(gLastScene, gCurrentScene, BUFFER_SIZE - 1);
     gLastScene[BUFFER_SIZE - 1] = '\0';
-    strncpy(gCurrentScene, sceneFile, BUFFER_SIZE - 1);
+    // pop_state reloads the scene from gCurrentScene itself
+    if (sceneFile != gCurrentScene) strncpy(gCurrentScene, sceneFile, BUFFER_SIZE - 1);
     gCurrentScene[BUFFER_SIZE - 1] = '\0';
+    sceneGraphPrefetch(gCurrentScene, PREFETCH_DEPTH, warmAsset);
     lua_pushstring(gL, gLastScene);
     lua_setglobal(gL, "last_scene");
-
-    char path[PATH_BUFFER_SIZE];
-    snprintf(path, PATH_BUFFER_SIZE, "mods/%s/%s", gGameState.moduleFolder, sceneFile);
-    gSceneThread = lua_newthread(gL);
-    if (luaL_loadfile(gSceneThread, path) != LUA_OK) {
-        const char *error = lua_tostring(gSceneThread, -1);
-        fprintf(stderr, "Error loading scene: %s\n", error);
+    beginSceneRun();
+
+    snprintf(gScenePath, PATH_BUFFER_SIZE, "mods/%s/%s", gGameState.moduleFolder, sceneFile);
+    clearAhead();
+    coroutineRelease(gSceneThread);
+    gSceneLine = 0;
+    gSceneLoads++;
+    StagedScene *stage = findStaged(sceneFile);
+    gChoiceStaged = stage && stage->thread;
+    if (gChoiceStaged) {
+        // Staged while the choice menu was up, its first line only has to be applied
+        gSceneThread = stage->thread;
+        stage->thread = NULL;
+        for (int i = 0; i < stage->commandCount; i++)
+            commandQueuePush(&stage->commands[i]);
+        // Its assignments land in _G as the player reaches them, like the running scene's
+        gAheadGlobals = stage->globals;
+        stage->globals = NO_AHEAD_GLOBALS;
+        gSceneEnded = stage->ended;
+        gAheadStopped = stage->stopped;
+        if (stage->commandCount > 0) gStagedHits++;
+        gStagedCommands += stage->commandCount;
+        gStagedAssets += stage->assets;
+        discardStaged();
+        advanceScene();
         return;
     }
-    push(&gameStateStack, gGameState);
-    int nres = 0;
-    int status = lua_resume(gSceneThread, gL, 0, &nres);
-    if (status != LUA_YIELD && status != LUA_OK) {
-        const char *error = lua_tostring(gSceneThread, -1);
-        fprintf(stderr, "Error starting scene: %s\n", error);
+    discardStaged();
+    gSceneThread = coroutineAcquire(gL);
+    gSceneEnded = false;
+    gAheadStopped = false;
+    if (loadSceneChunk(gSceneThread, gScenePath) != LUA_OK) {
+        reportSceneError("loading", gSceneThread);
+        gSceneEnded = true;
+        return;
     }
+    advanceScene();
 }
 
 static void rollbackScene(void) {
-    if (gGameState.hasBackground) {
-        UnloadTexture(gGameState.background);
-        gGameState.hasBackground = false;
-    }
-    for (int i = 0; i < gGameState.spriteCount; i++) {
-        UnloadTexture(gGameState.sprites[i].texture);
-    }
-    gGameState.spriteCount = 0;
-    if (gGameState.hasMusic) {
-        StopMusicStream(gGameState.music);
-        UnloadMusicStream(gGameState.music);
-        gGameState.hasMusic = false;
-    }
+    releaseSceneAssets();
     gGameState.hasDialog = false;
     gGameState.choiceCount = 0;
-    
-    gSceneThread = lua_newthread(gL);
     loadScene(gCurrentScene);
     
     TraceLog(LOG_INFO, "Rolled back and restarted scene: %s", gCurrentScene);
 }
 
+// Put the visible state back, assets shared with the current line are acquired before anything is released
+static void restoreCheckpoint(const HistoryFrame *frame) {
+    strncpy(gCurrentScene, internLookup(frame->scene), BUFFER_SIZE - 1);
+    strncpy(gLastScene, internLookup(frame->lastScene), BUFFER_SIZE - 1);
+    lua_pushstring(gL, gLastScene);
+    lua_setglobal(gL, "last_scene");
+
+    bool hasBackground = gGameState.background || gGameState.nextBackground;
+    if (!frame->background) {
+        assetRelease(gGameState.background);
+        assetRelease(gGameState.nextBackground);
+        gGameState.background = NULL;
+        gGameState.nextBackground = NULL;
+        gGameState.hasBackground = false;
+        gGameState.bgfile[0] = '\0';
+    } else if (!hasBackground || frame->background != internString(gGameState.bgfile)) {
+        setBackground(internLookup(frame->background));
+    }
+
+    if (!frame->music) {
+        musicStop();
+        gGameState.hasMusic = false;
+        gGameState.musicfile[0] = '\0';
+    } else if (!gGameState.hasMusic || frame->music != internString(gGameState.musicfile)) {
+        // Pick the track up where it was left rather than from the top
+        if (musicResume(internLookup(frame->music))) {
+            strncpy(gGameState.musicfile, internLookup(frame->music), PATH_BUFFER_SIZE - 1);
+            gGameState.hasMusic = true;
+        }
+    }
+
+    Sprite sprites[MAX_SPRITES];
+    for (int i = 0; i < frame->spriteCount; i++) {
+        const char *path = internLookup(frame->sprites[i].file);
+        sprites[i].texture = acquireTexture(ASSET_SPRITE, path);
+        sprites[i].pos = frame->sprites[i].pos;
+        sprites[i].hasID = frame->sprites[i].id != 0;
+        strncpy(sprites[i].id, internLookup(frame->sprites[i].id), BUFFER_SIZE - 1);
+        sprites[i].id[BUFFER_SIZE - 1] = '\0';
+        strncpy(gGameState.spritefiles[i], path, PATH_BUFFER_SIZE - 1);
+    }
+    for (int i = 0; i < gGameState.spriteCount; i++)
+        assetRelease(gGameState.sprites[i].texture);
+    memcpy(gGameState.sprites, sprites, frame->spriteCount * sizeof(Sprite));
+    gGameState.spriteCount = frame->spriteCount;
+
+    gGameState.hasDialog = frame->hasDialog;
+    strncpy(gGameState.dialogName, internLookup(frame->dialogName), BUFFER_SIZE - 1);
+    strncpy(gGameState.dialogText, internLookup(frame->dialogText), BUFFER_SIZE - 1);
+    gGameState.dialogNameColor = frame->dialogNameColor;
+    gGameState.textColor = frame->textColor;
+    gGameState.dialogHasPos = frame->dialogHasPos;
+    gGameState.dialogPos = frame->dialogPos;
+    gGameState.choiceCount = frame->choiceCount;
+    for (int i = 0; i < frame->choiceCount; i++) {
+        strncpy(gGameState.choices[i].text, internLookup(frame->choices[i].text), BUFFER_SIZE - 1);
+        strncpy(gGameState.choices[i].scene, internLookup(frame->choices[i].scene), BUFFER_SIZE - 1);
+    }
+}
+
+// A coroutine cannot be rewound, so run a fresh one up to the checkpoint's line with every engine call muted
+// The caller puts back the globals the scene started with first, the replayed lines assign them again
+static bool replayScene(const HistoryFrame *frame) {
+    lua_State *thread = coroutineAcquire(gL);
+    if (loadSceneChunk(thread, internLookup(frame->script)) != LUA_OK) {
+        reportSceneError("loading", thread);
+        coroutineRelease(thread);
+        return false;
+    }
+    strncpy(gScenePath, internLookup(frame->script), PATH_BUFFER_SIZE - 1);
+    clearAhead();
+    discardStaged();
+    coroutineRelease(gSceneThread);
+    gSceneThread = thread;
+    gSceneLine = 0;
+    gSceneEnded = false;
+    gAheadStopped = false;
+    lua_pushstring(gL, internLookup(frame->lastScene));
+    lua_setglobal(gL, "last_scene");
+    gReplaying = true;
+    while (gSceneLine < frame->line) {
+        int status = resumeTimed(thread);
+        if (status != LUA_YIELD) {
+            if (status != LUA_OK) reportSceneError("replaying", thread);
+            gSceneEnded = true;
+            break;
+        }
+        gSceneLine++;
+    }
+    gReplaying = false;
+    if (gSceneLine < frame->line)
+        TraceLog(LOG_WARNING, "Scene %s ended after %d of %d lines while rewinding", gScenePath, gSceneLine, frame->line);
+    return true;
+}
+
+// Step back one line, the previous checkpoint becomes the newest again
+static void rewindLine(void) {
+    if (historyCount() < 2) return;
+    historyPop();
+    HistoryFrame frame;
+    historyGet(historyCount() - 1, &frame);
+    const unsigned char *globals;
+    size_t size;
+    if (historyGlobals(historyCount() - 1, &globals, &size)) saveGameDecodeGlobals(gL, globals, size);
+    replayScene(&frame);
+    restoreCheckpoint(&frame);
+    runAhead();
+    TraceLog(LOG_INFO, "Rewound to line %d of %s", frame.line, gCurrentScene);
+}
+
+// Show the line on screen again as the edited scene has it, the lines before it are replayed muted like a rewind
+static void restartSceneLine(void) {
+    if (gSceneLine <= 1 || historyCount() < 2) {
+        rollbackScene();
+        return;
+    }
+    rewindLine();
+    advanceScene();
+    TraceLog(LOG_INFO, "Restarted %s at line %d", gCurrentScene, gSceneLine);
+}
+
+static void reloadScript(const char *path) {
+    scriptCacheDrop(gL, path);
+    // Compiled now so an error leaves the running scene alone
+    if (scriptCacheLoad(gL, path) != LUA_OK) {
+        TraceLog(LOG_WARNING, "Hot reload of %s failed: %s", path, lua_tostring(gL, -1));
+        lua_pop(gL, 1);
+        return;
+    }
+    lua_pop(gL, 1);
+    char folder[PATH_BUFFER_SIZE];
+    snprintf(folder, PATH_BUFFER_SIZE, "mods/%s", gGameState.moduleFolder);
+    if (strcmp(GetDirectoryPath(path), folder) == 0) sceneGraphRescan(GetFileName(path), path);
+    // Choice targets were staged from the old chunk, they are staged again while the menu is up
+    discardStaged();
+    TraceLog(LOG_INFO, "Hot reloaded scene: %s", path);
+    if (gHotRestart && screen == GAME && strcmp(path, gScenePath) == 0) restartSceneLine();
+}
+
+// Called by the watcher for every file edited under the module folder
+static void onFileChanged(const char *path) {
+    const char *extension = GetFileExtension(path);
+    if (extension && strcmp(extension, ".lua") == 0) {
+        reloadScript(path);
+        return;
+    }
+    TraceLog(LOG_INFO, "Hot reloaded asset: %s", path);
+    // An image on screen is decoded again and swapped in place, an unused one is only forgotten
+    texCacheDrop(path);
+    // Every kind the file was loaded as is read again, a background and a sprite are decoded differently
+    for (int kind = 0; kind < ASSET_KIND_COUNT; kind++) {
+        assetLoaderReload(kind, path);
+        if (assetCacheReload(kind, path)) assetLoaderRequest(kind, path);
+    }
+    sfxForget(path);
+    if (gGameState.hasMusic && strcmp(gGameState.musicfile, path) == 0) musicReload(path);
+}
+
 /* --- Lua API --- */
+// Whether a call can stop the run-ahead, only the scene's own thread outside of C callbacks can yield
+static bool runsAhead(lua_State *L) {
+    return gAheadThread && L == gAheadThread && lua_isyieldable(L);
+}
+
+static void parkAhead(void) {
+    if (gStaging) gStaging->stopped = true;
+    else gAheadStopped = true;
+}
+
+static int resumeLive(lua_State *L, int status, lua_KContext ctx) {
+    (void)status;
+    return ((lua_CFunction)ctx)(L);
+}
+
+// Park the scene at a call that has to happen when the player gets there, fn runs once it is resumed live
+static int stopRunAhead(lua_State *L, lua_CFunction fn) {
+    parkAhead();
+    gAheadStops++;
+    return lua_yieldk(L, 0, (lua_KContext)fn, resumeLive);
+}
+
+// False when the scene should park at the call instead, only once it is full and only where it can yield
+// A call that cannot yield is never applied ahead of the ones queued before it, the queue grows for it, a staged
+// scene is given up on and loads as usual if chosen
+static bool queueCommand(lua_State *L, const SceneCommand *command) {
+    if (!gStaging) {
+        if (commandQueueSize() >= COMMAND_QUEUE_CAPACITY && runsAhead(L)) return false;
+        if (!commandQueuePush(command)) luaL_error(L, "out of memory queuing a scene call");
+        return true;
+    }
+    if (gStaging->commandCount == STAGE_COMMANDS) {
+        if (runsAhead(L)) return false;
+        gStaging->failed = true;
+        luaL_error(L, "too many calls before the first line to stage");
+    }
+    commandRetain(command);
+    gStaging->commands[gStaging->commandCount++] = *command;
+    return true;
+}
+
+// Queue the call while running ahead, apply it otherwise, text and choices end the line either way
+static int issueCommand(lua_State *L, SceneCommand *command, lua_CFunction fn) {
+    if (!gAheadThread) {
+        applyCommand(command);
+    } else if (queueCommand(L, command)) {
+        prefetchCommand(command);
+        if (command->kind == COMMAND_CHOICES) parkAhead();
+    } else {
+        return stopRunAhead(L, fn);
+    }
+    return command->kind == COMMAND_TEXT || command->kind == COMMAND_CHOICES ? lua_yield(L, 0) : 0;
+}
+
+// Scenes see the globals through an empty proxy, so every assignment to a global comes through here
+// Made ahead of the player it is held back like an engine call, the scene reads the new value from its shadow
+static int l_scene_newindex(lua_State *L) {
+    lua_settop(L, 3);
+    if (gAheadThread) {
+        if (lua_isnil(L, 2)) return luaL_error(L, "index is nil");
+        if (lua_type(L, 2) == LUA_TNUMBER && lua_tonumber(L, 2) != lua_tonumber(L, 2)) return luaL_error(L, "index is NaN");
+        AheadGlobals *globals = gStaging ? &gStaging->globals : &gAheadGlobals;
+        SceneCommand command = { .kind = COMMAND_GLOBAL, .slot = globals->issued + 1 };
+        if (!queueCommand(L, &command)) return stopRunAhead(L, l_scene_newindex);
+        holdGlobal(L, globals, command.slot);
+        return 0;
+    }
+    lua_pushglobaltable(L);
+    lua_replace(L, 1);
+    lua_settable(L, 1);
+    return 0;
+}
+
 static int l_pop_state(lua_State *L) {
+    if (gReplaying) return 0;
+    if (runsAhead(L)) return stopRunAhead(L, l_pop_state);
     rollbackScene();
     return 0;
 }
 
+#ifndef VN_HEADLESS
+extern void glfwPostEmptyEvent(void); // part of raylib's desktop build, safe to call from any thread
+#endif
+
+// An idle frame blocks in EndDrawing until an event arrives, an edit has to count as one
+static void wakeEventLoop(void) {
+#ifndef VN_HEADLESS
+    glfwPostEmptyEvent();
+#endif
+}
+
+// Open a module's pack, watch and scene graph, entry is the script that called module_init if any
+static void initModule(const char *folder, const char *entry) {
+    gGameState.moduleFolder = folder;
+    packOpen(folder);
+    if (gHotReload) {
+        char watched[PATH_BUFFER_SIZE];
+        snprintf(watched, PATH_BUFFER_SIZE, "mods/%s", folder);
+        watcherStart(watched, wakeEventLoop);
+    }
+    sceneGraphBuild(folder);
+    if (entry) sceneGraphScan(gCurrentScene, entry);
+
+    const char *dumpPath = getenv("VN_SCENEGRAPH_DUMP");
+    if (dumpPath) {
+        FILE *out = fopen(dumpPath, "w");
+        if (out) {
+            sceneGraphDump(out);
+            fclose(out);
+            TraceLog(LOG_INFO, "Dumped scene graph to %s", dumpPath);
+        }
+    }
+    sceneGraphPrefetch(gCurrentScene, PREFETCH_DEPTH, warmAsset);
+}
+
 static int l_module_init(lua_State *L) {
-    gGameState.moduleFolder = luaL_checkstring(L, 1);
+    const char *folder = luaL_checkstring(L, 1);
+    if (gReplaying) return 0;
+    if (runsAhead(L)) return stopRunAhead(L, l_module_init);
+    // The entry script lives outside the module folder, scan it too so its choices are warmed
+    char entry[PATH_BUFFER_SIZE];
+    snprintf(entry, PATH_BUFFER_SIZE, "mods/%s/%s", gGameState.moduleFolder, gCurrentScene);
+    initModule(folder, entry);
     return 0;
 }
 
 static int l_load_background(lua_State *L) {
     const char *file = luaL_checkstring(L, 1);
+    if (gReplaying) return 0;
     char path[PATH_BUFFER_SIZE];
     snprintf(path, PATH_BUFFER_SIZE, "mods/%s/images/%s", gGameState.moduleFolder, file);
-
-    Texture2D *cached = get(&backgroundCache, path);
-    if (cached) {
-        gGameState.background = *cached;
-        TraceLog(LOG_INFO, "Loaded cached background: %s", file);
-        updateLRU(&backgroundLRU, path);
-    } else {
-        gGameState.background = LoadTexture(path);
-        char *key = strdup(path);
-        insert(&backgroundCache, key, gGameState.background);
-        insert(&backgroundLRU, first(&backgroundLRU), key);
-        TraceLog(LOG_INFO, "Loaded new background: %s", file);
-    }
-    strncpy(gGameState.bgfile, path, PATH_BUFFER_SIZE);
-    gGameState.hasBackground = true;
-    return 0;
+    SceneCommand command = { .kind = COMMAND_BACKGROUND, .file = internString(path) };
+    return issueCommand(L, &command, l_load_background);
 }
 
 static int l_load_sprite(lua_State *L) {
@@ -259,55 +1063,33 @@ static int l_load_sprite(lua_State *L) {
     const char *id = NULL;
     if (lua_gettop(L) >= 4 && lua_isstring(L, 4))
         id = lua_tostring(L, 4);
-    Vector2 pos = { (float)x, (float)y };
-
-    if (gGameState.spriteCount >= CACHE_SIZE)
-        return -1;
+    if (gReplaying) return 0;
 
     char path[PATH_BUFFER_SIZE];
     snprintf(path, PATH_BUFFER_SIZE, "mods/%s/images/%s", gGameState.moduleFolder, file);
-
-    Texture2D *cached = get(&spriteCache, path);
-    if (cached) {
-        gGameState.sprites[gGameState.spriteCount].texture = *cached;
-        TraceLog(LOG_INFO, "Loaded cached sprite: %s", file);
-        updateLRU(&spriteLRU, path);
-    } else {
-        gGameState.sprites[gGameState.spriteCount].texture = LoadTexture(path);
-        char *key = strdup(path);
-        insert(&spriteCache, key, gGameState.sprites[gGameState.spriteCount].texture);
-        insert(&spriteLRU, first(&spriteLRU), key);
-        TraceLog(LOG_INFO, "Loaded new sprite: %s", file);
-    }
-    gGameState.sprites[gGameState.spriteCount].pos = pos;
-    if (id) {
-        strncpy(gGameState.sprites[gGameState.spriteCount].id, id, BUFFER_SIZE - 1);
-        gGameState.sprites[gGameState.spriteCount].id[BUFFER_SIZE - 1] = '\0';
-        gGameState.sprites[gGameState.spriteCount].hasID = true;
-    } else {
-        gGameState.sprites[gGameState.spriteCount].hasID = false;
-    }
-    strncpy(gGameState.spritefiles[gGameState.spriteCount], path, PATH_BUFFER_SIZE);
-    gGameState.spriteCount++;
-    return 0;
+    SceneCommand command = {
+        .kind = COMMAND_SPRITE,
+        .file = internString(path),
+        .id = id ? internString(id) : 0,
+        .pos = { (float)x, (float)y },
+    };
+    return issueCommand(L, &command, l_load_sprite);
 }
 
 static int l_unload_sprite(lua_State *L) {
     const char *id = luaL_checkstring(L, 1);
-    for (int i = 0; i < gGameState.spriteCount; i++) {
-        if (gGameState.sprites[i].hasID && strcmp(gGameState.sprites[i].id, id) == 0) {
-            UnloadTexture(gGameState.sprites[i].texture);
-            if(!erase(&spriteCache, gGameState.spritefiles[i])) TraceLog(LOG_INFO, "Sprite was now in cache: %s", id); 
-            for (int j = i; j < gGameState.spriteCount - 1; j++) {
-                strncpy(gGameState.spritefiles[j], gGameState.spritefiles[j + 1], PATH_BUFFER_SIZE);
-                gGameState.sprites[j] = gGameState.sprites[j + 1];
-            }
-            gGameState.spriteCount--;
-            TraceLog(LOG_INFO, "Unloaded sprite with id: %s", id);
-            break;
-        }
-    }
-    return 0;
+    if (gReplaying) return 0;
+    SceneCommand command = { .kind = COMMAND_UNLOAD_SPRITE, .id = internString(id) };
+    return issueCommand(L, &command, l_unload_sprite);
+}
+
+static int l_load_font(lua_State *L) {
+    const char *file = luaL_checkstring(L, 1);
+    if (gReplaying) return 0;
+    char path[PATH_BUFFER_SIZE];
+    snprintf(path, PATH_BUFFER_SIZE, "mods/%s/fonts/%s", gGameState.moduleFolder, file);
+    SceneCommand command = { .kind = COMMAND_FONT, .file = internString(path) };
+    return issueCommand(L, &command, l_load_font);
 }
 
 static int l_play_music(lua_State *L) {
@@ -315,50 +1097,32 @@ static int l_play_music(lua_State *L) {
     float start = 0.0f;
     if (lua_gettop(L) >= 2 && lua_isnumber(L, 2))
         start = lua_tonumber(L, 2);
+    if (gReplaying) return 0;
     char path[PATH_BUFFER_SIZE];
     snprintf(path, PATH_BUFFER_SIZE, "mods/%s/music/%s", gGameState.moduleFolder, file);
-
-    Music *cached = get(&musicCache, path);
-    if (cached) {
-        gGameState.music = *cached;
-        TraceLog(LOG_INFO, "Loaded cached music: %s", file);
-        updateLRU(&musicLRU, path);
-    } else {
-        gGameState.music = LoadMusicStream(path);
-        char *key = strdup(path);
-        insert(&musicCache, key, gGameState.music);
-        insert(&musicLRU, first(&musicLRU), key);
-        TraceLog(LOG_INFO, "Loaded new music: %s", file);
-    }
-    PlayMusicStream(gGameState.music);
-    if (start > 0.0f)
-        SeekMusicStream(gGameState.music, start);
-    strncpy(gGameState.musicfile, path, PATH_BUFFER_SIZE);
-    gGameState.hasMusic = true;
-    return 0;
+    SceneCommand command = { .kind = COMMAND_MUSIC, .file = internString(path), .start = start };
+    return issueCommand(L, &command, l_play_music);
 }
 
 static int l_play_sound(lua_State *L) {
     const char *file = luaL_checkstring(L, 1);
+    if (gReplaying) return 0;
     char path[PATH_BUFFER_SIZE];
     snprintf(path, PATH_BUFFER_SIZE, "mods/%s/music/%s", gGameState.moduleFolder, file);
-    Sound s = LoadSound(path);
-    SetSoundVolume(s, soundVolume);
-    PlaySound(s);
-    TraceLog(LOG_INFO, "Played sound: %s", file);
-    return 0;
+    SceneCommand command = { .kind = COMMAND_SOUND, .file = internString(path) };
+    return issueCommand(L, &command, l_play_sound);
 }
 
 static int l_show_text(lua_State *L) {
+    if (gReplaying) return lua_yield(L, 0);
     luaL_checktype(L, 1, LUA_TTABLE);
+    SceneCommand command = { .kind = COMMAND_TEXT };
     lua_getfield(L, 1, "name");
-    const char *char_name = luaL_checkstring(L, -1);
-    strncpy(gGameState.dialogName, char_name, BUFFER_SIZE - 1);
-    gGameState.dialogName[BUFFER_SIZE - 1] = '\0';
+    command.name = internString(luaL_checkstring(L, -1));
     lua_pop(L, 1);
 
     lua_getfield(L, 1, "color");
-    Color nameColor = WHITE;
+    command.nameColor = WHITE;
     if (lua_istable(L, -1)) {
         lua_getfield(L, -1, "r");
         int r = luaL_optinteger(L, -1, 255);
@@ -372,15 +1136,13 @@ static int l_show_text(lua_State *L) {
         lua_getfield(L, -1, "a");
         int a = luaL_optinteger(L, -1, 255);
         lua_pop(L, 1);
-        nameColor = (Color){ r, g, b, a };
+        command.nameColor = (Color){ r, g, b, a };
     }
     lua_pop(L, 1);
 
-    const char *text = luaL_checkstring(L, 2);
-    strncpy(gGameState.dialogText, text, BUFFER_SIZE - 1);
-    gGameState.dialogText[BUFFER_SIZE - 1] = '\0';
+    command.text = internString(luaL_checkstring(L, 2));
 
-    Color textColor = WHITE;
+    command.textColor = WHITE;
     if (lua_gettop(L) >= 3 && lua_istable(L, 3)) {
         lua_getfield(L, 3, "r");
         int tr = luaL_optinteger(L, -1, 255);
@@ -394,64 +1156,183 @@ static int l_show_text(lua_State *L) {
         lua_getfield(L, 3, "a");
         int ta = luaL_optinteger(L, -1, 255);
         lua_pop(L, 1);
-        textColor = (Color){ tr, tg, tb, ta };
+        command.textColor = (Color){ tr, tg, tb, ta };
     }
     
-    int posX = 0, posY = 0;
-    bool hasPos = false;
     if (lua_gettop(L) >= 5 && lua_isnumber(L, 4) && lua_isnumber(L, 5)) {
-        posX = lua_tointeger(L, 4);
-        posY = lua_tointeger(L, 5);
-        hasPos = true;
-    }
-    
-    gGameState.dialogNameColor = nameColor;
-    gGameState.textColor = textColor;
-    if (hasPos) {
-        gGameState.dialogPos.x = (float)posX;
-        gGameState.dialogPos.y = (float)posY;
-        gGameState.dialogHasPos = true;
-    } else {
-        gGameState.dialogHasPos = false;
+        command.pos.x = (float)lua_tointeger(L, 4);
+        command.pos.y = (float)lua_tointeger(L, 5);
+        command.hasPos = true;
     }
-    gGameState.hasDialog = true;
-    TraceLog(LOG_INFO, "Show text: %s", gGameState.dialogText);
-    return lua_yield(L, 0);
+    return issueCommand(L, &command, l_show_text);
 }
 
 static int l_clear_text(lua_State *L) {
-    (void)L;
-    gGameState.dialogText[0] = '\0';
-    gGameState.dialogName[0] = '\0';
-    gGameState.hasDialog = false;
-    gGameState.dialogHasPos = false;
-    return 0;
+    if (gReplaying) return 0;
+    SceneCommand command = { .kind = COMMAND_CLEAR_TEXT };
+    return issueCommand(L, &command, l_clear_text);
 }
 
 static int l_set_choices(lua_State *L) {
     if (!lua_istable(L, 1)) return 0;
-    gGameState.choiceCount = 0;
+    if (gReplaying) return lua_yield(L, 0);
+    SceneCommand command = { .kind = COMMAND_CHOICES };
     lua_pushnil(L);
-    while (lua_next(L, 1) && gGameState.choiceCount < MAX_CHOICES) {
+    while (lua_next(L, 1) && command.choiceCount < MAX_CHOICES) {
         if (lua_istable(L, -1)) {
             lua_getfield(L, -1, "text");
             lua_getfield(L, -2, "scene");
             const char *text = luaL_checkstring(L, -2);
             const char *scene = luaL_checkstring(L, -1);
-            strncpy(gGameState.choices[gGameState.choiceCount].text, text, BUFFER_SIZE - 1);
-            gGameState.choices[gGameState.choiceCount].text[BUFFER_SIZE - 1] = '\0';
-            strncpy(gGameState.choices[gGameState.choiceCount].scene, scene, BUFFER_SIZE - 1);
-            gGameState.choices[gGameState.choiceCount].scene[BUFFER_SIZE - 1] = '\0';
-            gGameState.choiceCount++;
+            command.choices[command.choiceCount].text = internString(text);
+            command.choices[command.choiceCount].scene = internString(scene);
+            command.choiceCount++;
             lua_pop(L, 2);
         }
         lua_pop(L, 1);
     }
-    return lua_yield(L, 0);
+    return issueCommand(L, &command, l_set_choices);
+}
+
+static int l_set_cache_budget(lua_State *L) {
+    if (runsAhead(L)) return stopRunAhead(L, l_set_cache_budget);
+    lua_Number vram = luaL_checknumber(L, 1);
+    assetCacheSetBudget((size_t)(vram * 1024 * 1024));
+    return 0;
+}
+
+static int l_cache_stats(lua_State *L) {
+    if (runsAhead(L)) return stopRunAhead(L, l_cache_stats);
+    AssetCacheStats stats = assetCacheGetStats();
+    lua_createtable(L, 0, 12);
+    lua_pushinteger(L, (lua_Integer)stats.hits);
+    lua_setfield(L, -2, "hits");
+    lua_pushinteger(L, (lua_Integer)stats.misses);
+    lua_setfield(L, -2, "misses");
+    lua_pushinteger(L, (lua_Integer)stats.evictions);
+    lua_setfield(L, -2, "evictions");
+    lua_pushinteger(L, (lua_Integer)stats.vramUsed);
+    lua_setfield(L, -2, "vram_used");
+    lua_pushinteger(L, (lua_Integer)stats.vramBudget);
+    lua_setfield(L, -2, "vram_budget");
+    lua_pushinteger(L, musicOpenStreams());
+    lua_setfield(L, -2, "music_streams");
+    lua_pushinteger(L, stats.live);
+    lua_setfield(L, -2, "live");
+    PackStats pack = packGetStats();
+    lua_pushinteger(L, pack.files);
+    lua_setfield(L, -2, "pack_files");
+    lua_pushinteger(L, (lua_Integer)pack.hits);
+    lua_setfield(L, -2, "pack_hits");
+    TexCacheStats decoded = texCacheGetStats();
+    lua_pushinteger(L, (lua_Integer)decoded.hits);
+    lua_setfield(L, -2, "decoded_hits");
+    lua_pushinteger(L, (lua_Integer)decoded.misses);
+    lua_setfield(L, -2, "decoded_misses");
+    ResampleStats resampled = resampleGetStats();
+    lua_pushinteger(L, (lua_Integer)resampled.images);
+    lua_setfield(L, -2, "resampled");
+    return 1;
+}
+
+static int l_script_stats(lua_State *L) {
+    if (runsAhead(L)) return stopRunAhead(L, l_script_stats);
+    ScriptCacheStats stats = scriptCacheGetStats();
+    CoroutineStats threads = coroutineGetStats();
+    lua_createtable(L, 0, 16);
+    lua_pushinteger(L, (lua_Integer)stats.loads);
+    lua_setfield(L, -2, "loads");
+    lua_pushinteger(L, (lua_Integer)stats.memoryHits);
+    lua_setfield(L, -2, "memory_hits");
+    lua_pushinteger(L, (lua_Integer)stats.diskHits);
+    lua_setfield(L, -2, "disk_hits");
+    lua_pushinteger(L, (lua_Integer)stats.compiles);
+    lua_setfield(L, -2, "compiles");
+    lua_pushnumber(L, stats.loadTime * 1000.0);
+    lua_setfield(L, -2, "load_ms");
+    lua_pushinteger(L, (lua_Integer)threads.created);
+    lua_setfield(L, -2, "threads_created");
+    lua_pushinteger(L, (lua_Integer)threads.reused);
+    lua_setfield(L, -2, "threads_reused");
+    lua_pushinteger(L, lua_gettop(gL));
+    lua_setfield(L, -2, "main_stack");
+    lua_pushinteger(L, commandQueueLines());
+    lua_setfield(L, -2, "lines_ahead");
+    lua_pushinteger(L, (lua_Integer)gAheadStops);
+    lua_setfield(L, -2, "run_ahead_stops");
+    lua_pushinteger(L, (lua_Integer)gStagedHits);
+    lua_setfield(L, -2, "staged_choices");
+    lua_pushnumber(L, gChoiceLatency * 1000.0);
+    lua_setfield(L, -2, "choice_latency_ms");
+    lua_pushnumber(L, gResumeTime * 1000.0);
+    lua_setfield(L, -2, "resume_ms");
+    return 1;
+}
+
+static int l_gc_stats(lua_State *L) {
+    if (runsAhead(L)) return stopRunAhead(L, l_gc_stats);
+    LuaMemStats stats = luaMemGetStats();
+    lua_createtable(L, 0, 7);
+    lua_pushinteger(L, (lua_Integer)stats.allocations);
+    lua_setfield(L, -2, "allocations");
+    lua_pushinteger(L, (lua_Integer)stats.live);
+    lua_setfield(L, -2, "bytes_live");
+    lua_pushinteger(L, (lua_Integer)stats.pooled);
+    lua_setfield(L, -2, "pool_bytes");
+    lua_pushnumber(L, stats.frameGcTime * 1000.0);
+    lua_setfield(L, -2, "gc_ms");
+    lua_pushnumber(L, stats.maxGcTime * 1000.0);
+    lua_setfield(L, -2, "gc_max_ms");
+    lua_pushinteger(L, (lua_Integer)stats.steps);
+    lua_setfield(L, -2, "steps");
+    lua_pushinteger(L, (lua_Integer)stats.collections);
+    lua_setfield(L, -2, "full_collections");
+    return 1;
+}
+
+static int l_audio_stats(lua_State *L) {
+    if (runsAhead(L)) return stopRunAhead(L, l_audio_stats);
+    MusicStats stats = musicGetStats();
+    lua_createtable(L, 0, 4);
+    lua_pushinteger(L, (lua_Integer)stats.refills);
+    lua_setfield(L, -2, "refills");
+    lua_pushinteger(L, (lua_Integer)stats.late);
+    lua_setfield(L, -2, "late");
+    lua_pushnumber(L, stats.maxGap * 1000.0);
+    lua_setfield(L, -2, "max_gap_ms");
+    lua_pushinteger(L, stats.streams);
+    lua_setfield(L, -2, "streams");
+    return 1;
+}
+
+static int l_render_stats(lua_State *L) {
+    if (runsAhead(L)) return stopRunAhead(L, l_render_stats);
+    AtlasStats atlas = atlasGetStats();
+    GlyphAtlasStats glyphs = glyphAtlasGetStats();
+    lua_createtable(L, 0, 9);
+    lua_pushinteger(L, (lua_Integer)gSceneRebuilds);
+    lua_setfield(L, -2, "rebuilds");
+    lua_pushinteger(L, gFrameRenderStats.draws);
+    lua_setfield(L, -2, "draws");
+    lua_pushinteger(L, gFrameRenderStats.binds);
+    lua_setfield(L, -2, "binds");
+    lua_pushinteger(L, atlas.pages);
+    lua_setfield(L, -2, "atlas_pages");
+    lua_pushinteger(L, atlas.regions);
+    lua_setfield(L, -2, "atlas_regions");
+    lua_pushinteger(L, (lua_Integer)atlas.repacks);
+    lua_setfield(L, -2, "atlas_repacks");
+    lua_pushinteger(L, glyphs.pages);
+    lua_setfield(L, -2, "glyph_pages");
+    lua_pushinteger(L, (lua_Integer)glyphs.rasterized);
+    lua_setfield(L, -2, "glyphs_rasterized");
+    lua_pushinteger(L, (lua_Integer)glyphs.evictions);
+    lua_setfield(L, -2, "glyph_evictions");
+    return 1;
 }
 
 static int l_quit(lua_State *L) {
-    (void)L;
+    if (runsAhead(L)) return stopRunAhead(L, l_quit);
     gQuit = true;
     return 0;
 }
@@ -467,7 +1348,8 @@ typedef struct{;
 
 OptionsStyle gStyle = {0};
 
-void genericChoose(void* data, int* shortcuts, int count, const char* (*getLabel)(int, void*), void (*onSelect)(int, void*), OptionsStyle style) {
+// Returns the button under the mouse, -1 for none
+int genericChoose(void* data, int* shortcuts, int count, const char* (*getLabel)(int, void*), void (*onSelect)(int, void*), OptionsStyle style) {
     int btnHeight = (style.buttonHeight != 0) ? style.buttonHeight : style.font + 2 * style.padding;
     int textWidth = 0;
     int maxWidth = 0;
@@ -477,13 +1359,16 @@ void genericChoose(void* data, int* shortcuts, int count, const char* (*getLabel
     }
     int btnWidth = maxWidth + 2 * style.padding;
     int btnX = style.center ? (GetScreenWidth() - btnWidth) / 2 : style.baseRect.x + (style.baseRect.width - btnWidth) / 2;
+    int hovered = -1;
     for (int i = 0; i < count; i++) {
         int btnY = style.baseRect.y + i * (btnHeight + style.spacing);
         Rectangle btnRect = { (float)btnX, (float)btnY, (float)btnWidth, (float)btnHeight };
+        if (CheckCollisionPointRec(GetMousePosition(), btnRect)) hovered = i;
 
         if (IsKeyPressed(shortcuts[i]) || GuiButton(btnRect, getLabel(i, data)))
             onSelect(i, data);
     }
+    return hovered;
 }
 
 const char* getModuleLabel(int index, void* data) {
@@ -513,13 +1398,14 @@ static inline const char* getSceneLabel(int index, void* data) {
 static inline void onSceneSelect(int index, void* data) {
     Choice* choices = (Choice*)data;
     gGameState.choiceCount = 0;
+    gChoiceTime = GetTime();
     loadScene(choices[index].scene);
 }
 
 void chooseScene() {
     int shortCut[] = { KEY_ONE, KEY_TWO, KEY_THREE, KEY_FOUR, KEY_FIVE, KEY_SIX, KEY_SEVEN, KEY_EIGHT, KEY_NINE, KEY_ZERO };
     OptionsStyle Style = gStyle;
-    genericChoose((void*)gGameState.choices, shortCut, gGameState.choiceCount, getSceneLabel, onSceneSelect, Style);
+    gHoveredChoice = genericChoose((void*)gGameState.choices, shortCut, gGameState.choiceCount, getSceneLabel, onSceneSelect, Style);
 }
 
 static inline const char* getMenuItems(int index, void* data) {
@@ -587,6 +1473,7 @@ static void settingsMenu(void) {
     DrawText("SFX Volume", soundInnerX, soundInnerY, Style.font, WHITE);
     sliderRect = (Rectangle){ soundInnerX + labelWidth + 10, soundInnerY, (soundGroupRect.width - 20) - fontAlign - (labelWidth + 10), sliderHeight };
     GuiSlider(sliderRect, NULL, TextFormat("%0.2f", soundVolume), &soundVolume, 0.0f, 1.0f);
+    sfxSetVolume(masterVolume * soundVolume);
     
     int graphicsGroupY = soundGroupRect.y + soundGroupRect.height + 10;
     Rectangle graphicsGroupRect = { Style.baseRect.x + 10, graphicsGroupY, Style.baseRect.width - 20, (Style.font + 4) + 3 * verticalSpacing };
@@ -650,6 +1537,95 @@ static void settingsMenu(void) {
     }
 }
 
+static void saveSlot(int slot) {
+    HistoryFrame frame;
+    if (!historyGet(historyCount() - 1, &frame)) return;
+    SaveState state = { internString(gGameState.moduleFolder), internString(gGameState.fontfile), frame };
+    historyGlobals(historyCount() - 1, &state.entry, &state.entrySize);
+    saveGameWrite(slot, gL, &state);
+}
+
+// Only the saved scene is replayed, up to its line like a rewind, the playthrough that led there never runs again
+static bool loadSlot(int slot) {
+    double start = GetTime();
+    SaveState state = { 0 };
+    if (!saveGameRead(slot, gL, &state)) return false;
+    const char *folder = internLookup(state.module);
+    if (strcmp(folder, gGameState.moduleFolder) != 0) {
+        if (folder[0]) initModule(folder, NULL);
+        else gGameState.moduleFolder = "";
+    }
+    const char *font = internLookup(state.font);
+    if (strcmp(font, gGameState.fontfile) != 0) {
+        glyphAtlasUnload();
+        gGameState.fontfile[0] = '\0';
+        if (font[0] && glyphAtlasLoad(font)) strncpy(gGameState.fontfile, font, PATH_BUFFER_SIZE - 1);
+    }
+    // Replayed from the globals the scene started with, then the ones at the save are put back
+    // A save made before those were kept only has its own, which the replay adds to a second time
+    size_t savedSize;
+    unsigned char *saved = saveGameEncodeGlobals(gL, &savedSize);
+    if (state.entry && !saveGameDecodeGlobals(gL, state.entry, state.entrySize)) {
+        free((void *)state.entry);
+        state.entry = NULL;
+    }
+    bool replayed = replayScene(&state.frame);
+    if (saved) saveGameDecodeGlobals(gL, saved, savedSize);
+    if (replayed) {
+        restoreCheckpoint(&state.frame);
+        historyClear();
+        if (state.entry) historyBeginScene(state.entry, state.entrySize);
+        else historyBeginScene(saved, savedSize);
+        pushCheckpoint();
+    }
+    free(saved);
+    free((void *)state.entry);
+    if (!replayed) return false;
+    gSceneLoads++;
+    sceneGraphPrefetch(gCurrentScene, PREFETCH_DEPTH, warmAsset);
+    runAhead();
+    TraceLog(LOG_INFO, "Loaded slot %d: %s at line %d in %.2f ms", slot + 1, gCurrentScene, gSceneLine,
+             (GetTime() - start) * 1000.0);
+    return true;
+}
+
+static inline const char* getSlotLabel(int index, void* data) {
+    (void)data;
+    if (index == SAVE_SLOTS) return "Back";
+    SaveInfo info;
+    if (!saveGameInfo(index, &info)) return TextFormat("%d. Empty", index + 1);
+    char when[32];
+    time_t savedAt = (time_t)info.savedAt;
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M", localtime(&savedAt));
+    return TextFormat("%d. %s%s%s, line %d (%s)", index + 1, info.module, info.module[0] ? ": " : "", info.scene, info.line, when);
+}
+
+static inline void slotSelect(int index, void* data) {
+    (void)data;
+    if (index < SAVE_SLOTS) {
+        SaveInfo info;
+        if (menu == SAVE) {
+            saveSlot(index);
+        } else if (!saveGameInfo(index, &info) || !loadSlot(index)) {
+            return;
+        }
+        screen = GAME;
+        gGameState.isPaused = false;
+    }
+    menu = NONE;
+}
+
+void slotMenu() {
+    int shortCut[SAVE_SLOTS + 1];
+    for (int i = 0; i < SAVE_SLOTS; i++) shortCut[i] = KEY_ONE + i;
+    shortCut[SAVE_SLOTS] = KEY_BACKSPACE;
+    OptionsStyle Style = gStyle;
+    Style.spacing = 5;
+    if (screen == GAME) DrawRectangle(0, 0, GetScreenWidth(), GetScreenHeight(), Fade(GRAY, 0.8f));
+    GuiGroupBox((Rectangle){ Style.baseRect.x + Style.baseRect.width/4, Style.baseRect.y - 10, Style.baseRect.width/2, Style.baseRect.height }, menu == SAVE ? "Save Game" : "Load Game");
+    genericChoose(NULL, shortCut, SAVE_SLOTS + 1, getSlotLabel, slotSelect, Style);
+}
+
 static inline void pauseMenuSelect(int index, void* data) {
     (void)data;    
     switch (index) {
@@ -668,21 +1644,23 @@ static inline void pauseMenuSelect(int index, void* data) {
             gGameState.settings = true;
         } break;
         case 4: {
-            if (gGameState.hasBackground) UnloadTexture(gGameState.background);
-            gGameState.hasBackground = false;
-            for (int i = 0; i < gGameState.spriteCount; i++)
-                UnloadTexture(gGameState.sprites[i].texture);
-            if (gGameState.hasMusic) {
-                StopMusicStream(gGameState.music);
-                UnloadMusicStream(gGameState.music);
-            }
-            cleanup(&backgroundCache);
-            cleanup(&musicCache);
-            cleanup(&spriteCache);
-            cleanup(&gameStateStack);
-            cleanup(&backgroundLRU);
-            cleanup(&musicLRU);
-            cleanup(&spriteLRU);
+            releaseSceneAssets();
+            assetLoaderDiscard();
+            sceneGraphClear();
+            assetCacheClear();
+            watcherStop();
+            sfxClear();
+            musicClear();
+            glyphAtlasUnload();
+            gGameState.fontfile[0] = '\0';
+            scriptCacheClear(gL);
+            clearAhead();
+            discardStaged();
+            coroutineRelease(gSceneThread);
+            gSceneThread = NULL;
+            logHistoryStats();
+            historyClear();
+            internClear();
 
             gGameState.hasDialog = false;
             gGameState.moduleFolder = "";
@@ -707,46 +1685,46 @@ void pauseMenu() {
     genericChoose((void*)choices, shortCut, count, getMenuItems, pauseMenuSelect, Style);
 }
 
-static inline void updateBackground(Shader* spriteOutline) {
-    Texture2D bgTex = gGameState.background;
+static void drawSceneTexture(Texture2D texture, Rectangle source, Rectangle dest) {
+    if (texture.id != gBoundTexture) {
+        gRenderStats.binds++;
+        gBoundTexture = texture.id;
+    }
+    gRenderStats.draws++;
+    DrawTexturePro(texture, source, dest, (Vector2){ 0, 0 }, 0.0f, WHITE);
+}
+
+
+static inline void updateBackground(void) {
+    Texture2D bgTex = assetTexture(gGameState.background);
+    if (bgTex.id == 0) return;
+    // Sprites are placed in source pixels, the texture may have been resampled to the screen
+    Vector2 bgSize = assetSize(gGameState.background);
+    float texel = bgTex.height / bgSize.y;
     int windowWidth = GetScreenWidth(), windowHeight = GetScreenHeight();
-    float scale_bg = (float)windowHeight / bgTex.height;
+    float scale_bg = (float)windowHeight / bgSize.y;
     float desired_tex_width = (float)windowWidth / scale_bg;
-    float crop_x = (bgTex.width - desired_tex_width) / 2.0f;
-    Rectangle srcRect = { crop_x, 0, desired_tex_width, (float)bgTex.height };
+    float crop_x = (bgSize.x - desired_tex_width) / 2.0f;
+    Rectangle srcRect = { crop_x * texel, 0, desired_tex_width * texel, (float)bgTex.height };
     Rectangle dstRect = { 0, 0, (float)windowWidth, (float)windowHeight };
-    DrawTexturePro(bgTex, srcRect, dstRect, (Vector2){0,0}, 0.0f, WHITE);
-
-    if (gGameState.spriteCount > 0) {
-        float outlineSize = 8.0f;
-        float outlineColor[4] = { 0.2f, 0.2f, 0.2f, 0.2f };
-
-        for (int i = 0; i < gGameState.spriteCount; i++) {
-            Texture2D sprTex = gGameState.sprites[i].texture;
-            float drawn_x = (gGameState.sprites[i].pos.x - crop_x) * scale_bg;
-            float drawn_y = gGameState.sprites[i].pos.y * scale_bg;
-            float sprite_scale = (4.0/3.0 * windowHeight) / (float)sprTex.height;
-            Rectangle sprSrc = { 0, 0, (float)sprTex.width, (float)sprTex.height };
-            Rectangle sprDst = { drawn_x, drawn_y, sprTex.width * sprite_scale, sprTex.height * sprite_scale };
-
-            float textureSize[2] = { (float)sprTex.width, (float)sprTex.height };
-            int outlineSizeLoc = GetShaderLocation(*spriteOutline, "outlineSize");
-            int outlineColorLoc = GetShaderLocation(*spriteOutline, "outlineColor");
-            int textureSizeLoc = GetShaderLocation(*spriteOutline, "textureSize");
-            SetShaderValue(*spriteOutline, outlineSizeLoc, &outlineSize, SHADER_UNIFORM_FLOAT);
-            SetShaderValue(*spriteOutline, outlineColorLoc, outlineColor, SHADER_UNIFORM_VEC4);
-            SetShaderValue(*spriteOutline, textureSizeLoc, textureSize, SHADER_UNIFORM_VEC2);
-
-            BeginShaderMode(*spriteOutline);
-            DrawTexturePro(sprTex, sprSrc, sprDst, (Vector2){0, 0}, 0.0f, WHITE);
-            EndShaderMode();
-        }
+    drawSceneTexture(bgTex, srcRect, dstRect);
+
+    // Outlines are baked in and sprites share atlas pages, so consecutive sprites on a page are one batch
+    for (int i = 0; i < gGameState.spriteCount; i++) {
+        Texture2D sprTex = assetTexture(gGameState.sprites[i].texture);
+        if (sprTex.id == 0) continue;
+        Rectangle sprSrc = assetSource(gGameState.sprites[i].texture);
+        float drawn_x = (gGameState.sprites[i].pos.x - crop_x) * scale_bg;
+        float drawn_y = gGameState.sprites[i].pos.y * scale_bg;
+        float sprite_scale = (SPRITE_SCREEN_HEIGHT * windowHeight) / sprSrc.height;
+        Rectangle sprDst = { drawn_x, drawn_y, sprSrc.width * sprite_scale, sprSrc.height * sprite_scale };
+        drawSceneTexture(sprTex, sprSrc, sprDst);
     }
 }
 
 // Proportions for text box
 bool forward = false;
-static inline void updateText(Rectangle textRel) {
+static Rectangle dialogBox(Rectangle textRel) {
     Rectangle textBox;
     if (gGameState.dialogHasPos) {
         textBox.x = gGameState.dialogPos.x + textRel.x * GetScreenWidth();
@@ -757,19 +1735,43 @@ static inline void updateText(Rectangle textRel) {
     }
     textBox.width = textRel.width * GetScreenWidth();
     textBox.height = textRel.height * GetScreenHeight();
+    return textBox;
+}
+
+static inline void drawDialog(Rectangle textRel) {
+    Rectangle textBox = dialogBox(textRel);
     int textPadding = 10;
     Rectangle innerBox = { textBox.x + textPadding, textBox.y + textPadding,
                            textBox.width - 2 * textPadding, textBox.height - 2 * textPadding };
     DrawRectangleRec(textBox, Fade(BLACK, 0.5f));
     
-    if (gGameState.dialogName[0])
-        DrawText(gGameState.dialogName, textBox.x + 5, textBox.y - 25, 20, gGameState.dialogNameColor);
-    DrawTextBoxed(GetFontDefault(), gGameState.dialogText, innerBox, 20, 2, true, gGameState.textColor);
+    if (!glyphAtlasActive()) {
+        if (gGameState.dialogName[0])
+            DrawText(gGameState.dialogName, textBox.x + 5, textBox.y - 25, DIALOG_FONT_SIZE, gGameState.dialogNameColor);
+        const TextLayout *layout = textLayoutGet(GetFontDefault(), gGameState.dialogText, innerBox, DIALOG_FONT_SIZE, 2, true);
+        textLayoutDraw(layout, (Vector2){ innerBox.x, innerBox.y }, -1, gGameState.textColor);
+        return;
+    }
+
+    // Both pages first, making room for the text may clear cached layouts
+    float fontSize = DIALOG_FONT_SIZE * GetScreenHeight() / DIALOG_DESIGN_HEIGHT;
+    Font nameFont = glyphAtlasFont(gGameState.dialogName);
+    Font textFont = glyphAtlasFont(gGameState.dialogText);
+    Rectangle nameBox = { 0, 0, textBox.width, fontSize };
+    const TextLayout *name = textLayoutGet(nameFont, gGameState.dialogName, nameBox, fontSize, 2, false);
+    const TextLayout *text = textLayoutGet(textFont, gGameState.dialogText, innerBox, fontSize, 2, true);
+    BeginShaderMode(glyphAtlasShader());
+    textLayoutDraw(name, (Vector2){ textBox.x + 5, textBox.y - fontSize * 1.25f }, -1, gGameState.dialogNameColor);
+    textLayoutDraw(text, (Vector2){ innerBox.x, innerBox.y }, -1, gGameState.textColor);
+    EndShaderMode();
+}
 
+static inline void updateText(Rectangle textRel) {
+    Rectangle textBox = dialogBox(textRel);
     int btnWidth = 40, btnHeight = 30;
     Rectangle backBut = { textBox.width + textBox.x - 2*10 - 2*btnWidth, textBox.y + textBox.height - btnHeight - 10, btnWidth, btnHeight };
     if (GuiButton(backBut, "#130#")) {
-        rollbackScene();
+        rewindLine();
     }
     Rectangle forwardBut = { textBox.width + textBox.x - 10 - btnWidth, textBox.y + textBox.height - btnHeight - 10, btnWidth, btnHeight };
     if (GuiButton(forwardBut, "#131#")) {
@@ -777,37 +1779,369 @@ static inline void updateText(Rectangle textRel) {
     }
 }
 
-static inline void invAssets(void) {
-    while (size(&backgroundLRU) > CACHE_SIZE) {
-        char *key = (char *)last(&backgroundLRU);
-        Texture2D *tex = get(&backgroundCache, key);
-        if (tex) UnloadTexture(*tex);
-        erase(&backgroundCache, key);
-        erase(&backgroundLRU, last(&backgroundLRU));
-        TraceLog(LOG_INFO, "Evicted background: %s", key);
+static uint64_t hashBytes(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+#define HASH_VALUE(hash, value) hashBytes((hash), &(value), sizeof(value))
+
+// Everything the composed layers are drawn from, cheap enough to check every frame
+static uint64_t sceneSignature(void) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    int width = GetScreenWidth(), height = GetScreenHeight();
+    hash = HASH_VALUE(hash, width);
+    hash = HASH_VALUE(hash, height);
+    Texture2D bg = gGameState.hasBackground ? assetTexture(gGameState.background) : (Texture2D){ 0 };
+    hash = HASH_VALUE(hash, bg.id);
+    for (int i = 0; i < gGameState.spriteCount; i++) {
+        Texture2D texture = assetTexture(gGameState.sprites[i].texture);
+        Rectangle source = assetSource(gGameState.sprites[i].texture);
+        hash = HASH_VALUE(hash, texture.id);
+        hash = HASH_VALUE(hash, source);
+        hash = HASH_VALUE(hash, gGameState.sprites[i].pos);
     }
-    while (size(&musicLRU) > CACHE_SIZE) {
-        char *key = (char *)last(&musicLRU);
-        Music *mus = get(&musicCache, key);
-        if (mus) {
-            StopMusicStream(*mus);
-            UnloadMusicStream(*mus);
+    hash = HASH_VALUE(hash, gGameState.hasDialog);
+    bool moduleFont = glyphAtlasActive();
+    hash = HASH_VALUE(hash, moduleFont);
+    if (gGameState.hasDialog) {
+        hash = HASH_VALUE(hash, gGameState.dialogHasPos);
+        hash = HASH_VALUE(hash, gGameState.dialogPos);
+        hash = HASH_VALUE(hash, gGameState.dialogNameColor);
+        hash = HASH_VALUE(hash, gGameState.textColor);
+        hash = hashBytes(hash, gGameState.dialogName, strlen(gGameState.dialogName) + 1);
+        hash = hashBytes(hash, gGameState.dialogText, strlen(gGameState.dialogText) + 1);
+    }
+    return hash;
+}
+
+// Redraw the scene layers into gSceneTarget if anything they depend on changed, returns whether it did
+static bool composeScene(Rectangle textRel) {
+    int width = GetScreenWidth(), height = GetScreenHeight();
+    if (gSceneTarget.id == 0 || gSceneTarget.texture.width != width || gSceneTarget.texture.height != height) {
+        if (gSceneTarget.id != 0) UnloadRenderTexture(gSceneTarget);
+        gSceneTarget = LoadRenderTexture(width, height);
+        gSceneStale = true;
+    }
+    uint64_t signature = sceneSignature();
+    if (!gSceneStale && signature == gSceneSignature) return false;
+
+    BeginTextureMode(gSceneTarget);
+    ClearBackground(RAYWHITE);
+    if (gGameState.hasBackground) updateBackground();
+    if (gGameState.hasDialog) drawDialog(textRel);
+    // Blending leaves the target's alpha below one under the dialog box, adding opaque black restores it
+    BeginBlendMode(BLEND_ADD_COLORS);
+    DrawRectangle(0, 0, width, height, BLACK);
+    EndBlendMode();
+    EndTextureMode();
+
+    gFrameRenderStats = gRenderStats;
+    gRenderStats = (RenderStats){ 0 };
+    gBoundTexture = 0;
+    gSceneSignature = signature;
+    gSceneStale = false;
+    gSceneRebuilds++;
+    return true;
+}
+
+static void drawScene(void) {
+    // Render textures are stored bottom up
+    Rectangle source = { 0, 0, (float)gSceneTarget.texture.width, -(float)gSceneTarget.texture.height };
+    DrawTextureRec(gSceneTarget.texture, source, (Vector2){ 0, 0 }, WHITE);
+}
+
+#define SOAK_WARMUP 1000      // transitions before the baseline is taken, caches fill up until then
+#define SOAK_HEAP_SLACK 65536 // bytes the Lua heap may drift above the baseline
+
+static size_t luaHeapBytes(void) {
+    lua_gc(gL, LUA_GCCOLLECT);
+    return (size_t)lua_gc(gL, LUA_GCCOUNT) * 1024 + lua_gc(gL, LUA_GCCOUNTB);
+}
+
+// Play through a number of scene transitions without input, taking choices in turn, run by make soak
+static int soakRun(const char *entry, unsigned long transitions) {
+    screen = GAME;
+    loadScene(entry);
+    unsigned long start = gSceneLoads;
+    unsigned long errors = gSceneErrors;
+    // A short run takes its baseline halfway through
+    unsigned long warmup = transitions < 2 * SOAK_WARMUP ? transitions / 2 : SOAK_WARMUP;
+    size_t baseHeap = 0;
+    int baseTop = 0;
+    bool baseline = false;
+    while (!gQuit && gSceneLoads - start < transitions) {
+        unsigned long frameLoads = gSceneLoads;
+        updateAssetTarget();
+        assetLoaderUpload(UPLOAD_BUDGET, onAssetReady);
+        presentNextBackground();
+        if (gGameState.choiceCount > 0 && choicesUnstaged()) {
+            stageChoices(-1);
+        } else if (gGameState.choiceCount > 0) {
+            onSceneSelect((int)((gSceneLoads - start) % gGameState.choiceCount), gGameState.choices);
+        } else if (sceneCanAdvance()) {
+            advanceScene();
+        } else {
+            TraceLog(LOG_ERROR, "Soak stopped in %s, the scene ended without choices", gCurrentScene);
+            return 1;
+        }
+        assetCacheEndFrame();
+        coroutineCollect(gL);
+        luaMemEndFrame(gL, gSceneLoads != frameLoads);
+        if (!baseline && gSceneLoads - start >= warmup) {
+            baseHeap = luaHeapBytes();
+            baseTop = lua_gettop(gL);
+            baseline = true;
         }
-        erase(&musicCache, key);
-        erase(&musicLRU, last(&musicLRU));
-        TraceLog(LOG_INFO, "Evicted music: %s", key);
     }
-    while (size(&spriteLRU) > CACHE_SIZE) {
-        char *key = (char *)last(&spriteLRU);
-        Texture2D *tex = get(&spriteCache, key);
-        if (tex) UnloadTexture(*tex);
-        erase(&spriteCache, key);
-        erase(&spriteLRU, last(&spriteLRU));
-        TraceLog(LOG_INFO, "Evicted sprite: %s", key);
+
+    size_t heap = luaHeapBytes();
+    int top = lua_gettop(gL);
+    CoroutineStats threads = coroutineGetStats();
+    TraceLog(LOG_INFO, "Soak: %lu transitions, Lua heap %zu -> %zu bytes, main stack %d -> %d, %lu threads created, %lu reused",
+             gSceneLoads - start, baseHeap, heap, baseTop, top, threads.created, threads.reused);
+    if (!baseline || heap > baseHeap + SOAK_HEAP_SLACK || top != baseTop) {
+        TraceLog(LOG_ERROR, "Soak failed, Lua state grew over the run");
+        return 1;
+    }
+    // A failed assert in a test scene lands here
+    if (gSceneErrors != errors) {
+        TraceLog(LOG_ERROR, "Soak failed, %lu scene errors", gSceneErrors - errors);
+        return 1;
     }
+    return 0;
 }
 
-int main(void) {
+#define BENCH_MAX_STEPS 256     // choices in a playthrough file
+#define BENCH_SETTLE_TIME 5.0   // seconds a transition may wait on its images before it counts as stalled
+#define BENCH_FRAME_TIME 0.001  // far below vsync, but the music thread still drains its queue between transitions
+
+static bool sceneSettled(void) {
+    if (gGameState.nextBackground) return false;
+    if (gGameState.hasBackground && !assetReady(gGameState.background)) return false;
+    for (int i = 0; i < gGameState.spriteCount; i++)
+        if (!assetReady(gGameState.sprites[i].texture)) return false;
+    return true;
+}
+
+// A line of the playthrough is a choice's text or its number counted from 1
+static int benchChoice(const char *step) {
+    char *end = NULL;
+    long number = strtol(step, &end, 10);
+    if (end != step && *end == '\0') return number >= 1 && number <= gGameState.choiceCount ? (int)number - 1 : -1;
+    for (int i = 0; i < gGameState.choiceCount; i++)
+        if (strcasecmp(gGameState.choices[i].text, step) == 0) return i;
+    return -1;
+}
+
+static int readPlaythrough(const char *path, char steps[][BUFFER_SIZE]) {
+    FILE *in = fopen(path, "r");
+    if (!in) return -1;
+    int count = 0;
+    char line[BUFFER_SIZE];
+    while (count < BENCH_MAX_STEPS && fgets(line, sizeof(line), in)) {
+        char *start = line;
+        while (*start == ' ' || *start == '\t') start++;
+        size_t length = strlen(start);
+        while (length > 0 && (start[length - 1] == '\n' || start[length - 1] == '\r' || start[length - 1] == ' ')) start[--length] = '\0';
+        if (length == 0 || start[0] == '#') continue;
+        strcpy(steps[count++], start);
+    }
+    fclose(in);
+    return count;
+}
+
+static int compareDouble(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, int count, double p) {
+    if (count == 0) return 0;
+    int index = (int)(p / 100.0 * count + 0.999999) - 1;
+    return sorted[index < 0 ? 0 : index >= count ? count - 1 : index];
+}
+
+static long peakRssKb(void) {
+#ifdef _WIN32
+    return 0;
+#else
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+#endif
+}
+
+// Play a module through the choices listed in a file, rounds times over, and print the timings as JSON, run by make bench
+static int benchRun(const char *entry, const char *playthrough, int rounds, Rectangle textRel) {
+    static char steps[BENCH_MAX_STEPS][BUFFER_SIZE];
+    int stepCount = readPlaythrough(playthrough, steps);
+    if (stepCount <= 0) {
+        TraceLog(LOG_ERROR, "Bench: no choices to take in %s", playthrough);
+        return 1;
+    }
+    double *latencies = malloc(sizeof(double) * stepCount * rounds);
+    if (!latencies) return 1;
+    int transitions = 0, stalled = 0;
+    unsigned long lines = 0;
+    double benchStart = GetTime();
+    double resumeStart = gResumeTime;
+    screen = GAME;
+
+    for (int round = 0; round < rounds; round++) {
+        // Back to the entry script in mods/, its module_init picks the folder again
+        gGameState.moduleFolder = "";
+        loadScene(entry);
+        int next = 0;
+        double chosen = 0; // when the choice being timed was taken
+        while (next < stepCount || chosen > 0) {
+            unsigned long frameLoads = gSceneLoads;
+            updateAssetTarget();
+            assetLoaderUpload(UPLOAD_BUDGET, onAssetReady);
+            presentNextBackground();
+            if (chosen > 0) {
+                // Waiting on the chosen scene's images, the frame below shows whatever is ready
+            } else if (gGameState.choiceCount > 0 && choicesUnstaged()) {
+                stageChoices(-1);
+            } else if (gGameState.choiceCount > 0) {
+                int choice = benchChoice(steps[next]);
+                if (choice < 0) {
+                    TraceLog(LOG_ERROR, "Bench: no choice \"%s\" in %s", steps[next], gCurrentScene);
+                    free(latencies);
+                    return 1;
+                }
+                next++;
+                chosen = GetTime();
+                onSceneSelect(choice, gGameState.choices);
+            } else if (sceneCanAdvance()) {
+                advanceScene();
+                lines++;
+            } else {
+                TraceLog(LOG_ERROR, "Bench: %s ended without choices, %d of %d steps taken", gCurrentScene, next, stepCount);
+                free(latencies);
+                return 1;
+            }
+            BeginDrawing();
+            composeScene(textRel);
+            drawScene();
+            EndDrawing();
+            double now = GetTime();
+            bool timedOut = chosen > 0 && now - chosen > BENCH_SETTLE_TIME;
+            if (chosen > 0 && (sceneSettled() || timedOut)) {
+                latencies[transitions++] = now - chosen;
+                if (timedOut) stalled++;
+                chosen = 0;
+            }
+            assetCacheEndFrame();
+            coroutineCollect(gL);
+            luaMemEndFrame(gL, gSceneLoads != frameLoads);
+            double rest = BENCH_FRAME_TIME - (GetTime() - now);
+            if (rest > 0) nanosleep(&(struct timespec){ 0, (long)(rest * 1e9) }, NULL);
+        }
+    }
+
+    double elapsed = GetTime() - benchStart;
+    double resume = gResumeTime - resumeStart;
+    qsort(latencies, transitions, sizeof(double), compareDouble);
+    double total = 0;
+    for (int i = 0; i < transitions; i++)
+        total += latencies[i];
+    AssetCacheStats assets = assetCacheGetStats();
+    ScriptCacheStats scripts = scriptCacheGetStats();
+    LuaMemStats memory = luaMemGetStats();
+    unsigned long assetLookups = assets.hits + assets.misses;
+    unsigned long scriptHits = scripts.memoryHits + scripts.diskHits;
+
+    printf("{\n");
+    printf("  \"entry\": \"%s\",\n  \"playthrough\": \"%s\",\n", entry, playthrough);
+    printf("  \"rounds\": %d,\n  \"transitions\": %d,\n  \"lines\": %lu,\n  \"stalled_transitions\": %d,\n", rounds, transitions, lines, stalled);
+    printf("  \"transition_ms\": { \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f, \"mean\": %.3f },\n",
+           percentile(latencies, transitions, 50) * 1000.0, percentile(latencies, transitions, 90) * 1000.0,
+           percentile(latencies, transitions, 99) * 1000.0, percentile(latencies, transitions, 100) * 1000.0,
+           transitions ? total / transitions * 1000.0 : 0.0);
+    printf("  \"lua_resume_ms\": %.3f,\n  \"lua_resume_per_transition_ms\": %.3f,\n", resume * 1000.0, transitions ? resume / transitions * 1000.0 : 0.0);
+    printf("  \"gc_max_ms\": %.3f,\n  \"gc_full_collections\": %lu,\n", memory.maxGcTime * 1000.0, memory.collections);
+    printf("  \"asset_cache\": { \"hits\": %lu, \"misses\": %lu, \"evictions\": %lu, \"hit_rate\": %.4f },\n",
+           assets.hits, assets.misses, assets.evictions, assetLookups ? (double)assets.hits / assetLookups : 0.0);
+    printf("  \"script_cache\": { \"loads\": %lu, \"memory_hits\": %lu, \"disk_hits\": %lu, \"hit_rate\": %.4f },\n",
+           scripts.loads, scripts.memoryHits, scripts.diskHits, scripts.loads ? (double)scriptHits / scripts.loads : 0.0);
+    printf("  \"staged_choices\": { \"hits\": %lu, \"hit_rate\": %.4f, \"commands\": %lu, \"assets\": %lu },\n", gStagedHits,
+           transitions ? (double)gStagedHits / transitions : 0.0, gStagedCommands, gStagedAssets);
+    TexCacheStats decoded = texCacheGetStats();
+    printf("  \"decoded_cache\": { \"hits\": %lu, \"misses\": %lu, \"read_ms\": %.3f },\n", decoded.hits, decoded.misses, decoded.readTime * 1000.0);
+    ResampleStats resampled = resampleGetStats();
+    printf("  \"resample\": { \"images\": %lu, \"source_bytes\": %zu, \"result_bytes\": %zu, \"ms\": %.3f },\n",
+           resampled.images, resampled.sourceBytes, resampled.resultBytes, resampled.time * 1000.0);
+    PackStats pack = packGetStats();
+    printf("  \"pack\": { \"files\": %u, \"hits\": %lu, \"mapped_bytes\": %zu },\n", pack.files, pack.hits, pack.mappedBytes);
+#ifdef VN_HEADLESS
+    HeadlessStats headless = headlessGetStats();
+    printf("  \"texture_bytes_peak\": %zu,\n  \"texture_upload_bytes\": %zu,\n", headless.peakTextureBytes, headless.uploadBytes);
+#endif
+    printf("  \"peak_rss_kb\": %ld,\n  \"wall_ms\": %.3f\n}\n", peakRssKb(), elapsed * 1000.0);
+    free(latencies);
+    return stalled ? 1 : 0;
+}
+
+// Scenes read globals straight through and write them via l_scene_newindex
+static void createSceneEnv(lua_State *L) {
+    lua_newtable(L);
+    lua_createtable(L, 0, 2);
+    lua_pushglobaltable(L);
+    lua_setfield(L, -2, "__index");
+    lua_pushcfunction(L, l_scene_newindex);
+    lua_setfield(L, -2, "__newindex");
+    lua_setmetatable(L, -2);
+    lua_setfield(L, LUA_REGISTRYINDEX, SCENE_ENV_KEY);
+}
+
+// Write bytecode caches for every scene of a module, run by make precompile
+static int precompileModule(const char *module) {
+    char dir[PATH_BUFFER_SIZE];
+    snprintf(dir, PATH_BUFFER_SIZE, "mods/%s", module);
+    if (!DirectoryExists(dir)) {
+        TraceLog(LOG_ERROR, "No module folder %s", dir);
+        return 1;
+    }
+    lua_State *L = luaL_newstate();
+    FilePathList files = LoadDirectoryFilesEx(dir, ".lua", false);
+    unsigned int failed = 0;
+    for (unsigned int i = 0; i < files.count; i++)
+        if (!scriptCacheCompile(L, files.paths[i])) failed++;
+    TraceLog(LOG_INFO, "Precompiled %u of %u scenes in %s", files.count - failed, files.count, dir);
+    UnloadDirectoryFiles(files);
+    lua_close(L);
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc == 3 && strcmp(argv[1], "--precompile") == 0) return precompileModule(argv[2]);
+    if (argc == 3 && strcmp(argv[1], "--pack") == 0) return packBuild(argv[2]) ? 0 : 1;
+    const char *soakEntry = NULL;
+    unsigned long soakTransitions = 0;
+    if (argc == 4 && strcmp(argv[1], "--soak") == 0) {
+        soakEntry = argv[2];
+        soakTransitions = strtoul(argv[3], NULL, 10);
+    }
+    const char *benchEntry = NULL;
+    const char *benchPlaythrough = NULL;
+    int benchRounds = 1;
+    if ((argc == 4 || argc == 5) && strcmp(argv[1], "--bench") == 0) {
+        benchEntry = argv[2];
+        benchPlaythrough = argv[3];
+        if (argc == 5) benchRounds = atoi(argv[4]) > 0 ? atoi(argv[4]) : 1;
+        // Keep stdout to the report
+        SetTraceLogLevel(LOG_WARNING);
+    }
+
+    // VN_HOT_RELOAD=1 reloads edited module files in place, VN_HOT_RELOAD=restart also replays an edited scene to its line
+    const char *hotReload = getenv("VN_HOT_RELOAD");
+    gHotReload = hotReload && hotReload[0] && strcmp(hotReload, "0") != 0;
+    gHotRestart = gHotReload && strcmp(hotReload, "restart") == 0;
+
     gGameState.screenWidth = 1024;
     gGameState.screenHeight = 768;
     gStyle = (OptionsStyle){
@@ -829,15 +2163,24 @@ int main(void) {
     InitWindow(gGameState.screenWidth, gGameState.screenHeight, "VN Engine");
     InitAudioDevice();
     masterVolume = GetMasterVolume();
-    Shader spriteOutline = LoadShader(0, TextFormat("src/outline-%i.fs", GLSL_VERSION));
-
-    gL = luaL_newstate();
+    sfxSetVolume(masterVolume * soundVolume);
+    musicInit();
+#ifdef VN_HEADLESS
+    // Headless images are blank, they must never stand in for the real pixels on the next launch
+    texCacheSetWritable(false);
+#endif
+    assetLoaderSetTarget(GetScreenHeight());
+    assetLoaderInit(ASSET_WORKERS);
+
+    gL = luaMemNewState();
     luaL_openlibs(gL);
+    createSceneEnv(gL);
 
     lua_register(gL, "load_background", l_load_background);
     lua_register(gL, "load_sprite", l_load_sprite);
     lua_register(gL, "unload_sprite", l_unload_sprite);
     lua_register(gL, "play_music", l_play_music);
+    lua_register(gL, "load_font", l_load_font);
     lua_register(gL, "play_sound", l_play_sound);
     lua_register(gL, "show_text", l_show_text);
     lua_register(gL, "clear_text", l_clear_text);
@@ -845,19 +2188,38 @@ int main(void) {
     lua_register(gL, "quit", l_quit);
     lua_register(gL, "module_init", l_module_init);
     lua_register(gL, "pop_state", l_pop_state);
+    lua_register(gL, "set_cache_budget", l_set_cache_budget);
+    lua_register(gL, "cache_stats", l_cache_stats);
+    lua_register(gL, "audio_stats", l_audio_stats);
+    lua_register(gL, "script_stats", l_script_stats);
+    lua_register(gL, "gc_stats", l_gc_stats);
+    lua_register(gL, "render_stats", l_render_stats);
+    // Set by the engine on every transition, anything else a script assigns is saved with the game
+    lua_pushstring(gL, "");
+    lua_setglobal(gL, "last_scene");
+    saveGameMarkGlobals(gL);
 
     FilePathList scenes = LoadDirectoryFilesEx("mods", ".lua", 0);
-    init(&backgroundCache);
-    init(&musicCache);
-    init(&spriteCache);
-    init(&gameStateStack);
-    init(&backgroundLRU);
-    init(&musicLRU);
-    init(&spriteLRU);
+    assetCacheInit(CACHE_VRAM_BUDGET);
+
+    int status = 0;
+    if (soakEntry) {
+        status = soakRun(soakEntry, soakTransitions);
+        gQuit = true;
+    } else if (benchEntry) {
+        status = benchRun(benchEntry, benchPlaythrough, benchRounds, textRel);
+        gQuit = true;
+    }
 
     SetTargetFPS(60);
     while (!gQuit) {
         if (WindowShouldClose()) gQuit = true;
+        unsigned long frameLoads = gSceneLoads;
+        bool choiceTaken = gChoiceTime > 0; // this frame is the first to compose the chosen scene
+        watcherPoll(onFileChanged);
+        updateAssetTarget();
+        assetLoaderUpload(UPLOAD_BUDGET, onAssetReady);
+        presentNextBackground();
         BeginDrawing();
         ClearBackground(RAYWHITE);
         switch (screen) {
@@ -869,7 +2231,9 @@ int main(void) {
                 case MODULE: {
                     chooseModule(&scenes);
                 } break;
-                case LOAD: {} break;
+                case LOAD: {
+                    slotMenu();
+                } break;
                 case SETTINGS: {
                     settingsMenu();
                 } break;
@@ -879,26 +2243,17 @@ int main(void) {
             } break;
         } break;
         case GAME: {
-            if (gGameState.hasMusic) {
-                SetMusicVolume(gGameState.music, masterVolume*musicVolume);
-                UpdateMusicStream(gGameState.music);
-            }
+            musicSetVolume(masterVolume*musicVolume);
     
             if (gGameState.hasDialog && gGameState.choiceCount == 0) {
-                if (lua_status(gSceneThread) == LUA_YIELD && ( forward || IsKeyPressed(KEY_SPACE))) {
+                if (sceneCanAdvance() && ( forward || IsKeyPressed(KEY_SPACE))) {
                     forward = false;
-                    int nres = 0;
-                    int status = lua_resume(gSceneThread, gL, 0, &nres);
-                    if (status != LUA_YIELD && status != LUA_OK) {
-                        const char *error = lua_tostring(gSceneThread, -1);
-                        fprintf(stderr, "Error resuming scene: %s\n", error);
-                    }
+                    advanceScene();
                 }
             }
     
-            if (gGameState.hasBackground) {
-                updateBackground(&spriteOutline);
-            }
+            composeScene(textRel);
+            drawScene();
             if (gGameState.hasDialog) {
                 updateText(textRel);
             }
@@ -908,25 +2263,59 @@ int main(void) {
             int btnWidth = 40, btnHeight = 30;
             Rectangle pauseBut = { gGameState.screenWidth - btnWidth - 10, 10, btnWidth, btnHeight };
             if (IsKeyPressed(KEY_P) || GuiButton(pauseBut, "#132#")) gGameState.isPaused = true;
-            if (gGameState.isPaused) pauseMenu();
+            if (gGameState.isPaused) {
+                if (menu == SAVE || menu == LOAD) slotMenu();
+                else pauseMenu();
+            }
             if (gGameState.settings) settingsMenu();
             } break;
             default: break;
         } 
-        invAssets();
         EndDrawing();
+        if (choiceTaken) {
+            gChoiceLatency = GetTime() - gChoiceTime;
+            gChoiceTime = 0;
+            TraceLog(LOG_INFO, "Choice to first frame: %.2f ms%s", gChoiceLatency * 1000.0, gChoiceStaged ? ", staged" : "");
+        }
+        // Frame time left over while the player reads the choices goes into preparing them
+        if (screen == GAME && gGameState.choiceCount > 0) stageChoices(gHoveredChoice);
+        // Nothing animates on a static screen, so sleep until input instead of redrawing at the target FPS
+        bool idle = !assetLoaderBusy() && !gGameState.nextBackground && !gSceneStale &&
+                    (screen != GAME || (sceneSignature() == gSceneSignature && !choicesUnstaged()));
+        if (idle != gIdle) {
+            if (idle) EnableEventWaiting();
+            else DisableEventWaiting();
+            gIdle = idle;
+        }
+        // Only after the batch is flushed, so nothing drawn this frame is unloaded under it
+        assetCacheEndFrame();
+        coroutineCollect(gL);
+        // Collect while waiting on vsync rather than inside a script call, a transition already hitches so it pays for a full cycle
+        luaMemEndFrame(gL, gSceneLoads != frameLoads);
     }
 
     UnloadDirectoryFiles(scenes);
-    if (gGameState.hasBackground) UnloadTexture(gGameState.background);
-    for (int i = 0; i < gGameState.spriteCount; i++)
-        UnloadTexture(gGameState.sprites[i].texture);
-    if (gGameState.hasMusic) {
-        StopMusicStream(gGameState.music);
-        UnloadMusicStream(gGameState.music);
-    }
+    releaseSceneAssets();
+    assetCacheClear();
+    AssetCacheStats stats = assetCacheGetStats();
+    TraceLog(LOG_INFO, "Asset cache: %lu hits, %lu misses, %lu evictions", stats.hits, stats.misses, stats.evictions);
+    logHistoryStats();
+    historyClear();
+    internClear();
+    coroutineClear(gL);
     lua_close(gL);
+    luaMemShutdown();
+    sceneGraphClear();
+    if (gSceneTarget.id != 0) UnloadRenderTexture(gSceneTarget);
+    glyphAtlasUnload();
+    textLayoutClear();
+    assetLoaderShutdown();
+    watcherStop();
+    saveGameShutdown();
+    sfxClear();
+    musicShutdown();
+    packShutdown();
     CloseAudioDevice();
     CloseWindow();
-    return 0;
+    return status;
 }
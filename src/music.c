@@ -0,0 +1,303 @@
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <raylib.h>
+#include "music.h"
+#include "pack.h"
+
+enum {
+    CMD_PLAY,
+    CMD_RESUME,
+    CMD_STOP,
+    CMD_VOLUME,
+    CMD_CLEAR,
+    CMD_RELOAD,
+};
+
+typedef struct {
+    int type;
+    float value;
+    char path[MUSIC_PATH_SIZE];
+} MusicCommand;
+
+typedef struct {
+    Music music;
+    bool open;
+    float gain;   // crossfade position, 0 silent to 1 full volume
+    float target;
+    char path[MUSIC_PATH_SIZE];
+} MusicVoice;
+
+// A closed track costs a path and a float instead of a file handle and a decoder
+typedef struct {
+    char path[MUSIC_PATH_SIZE];
+    float position;
+    unsigned long used;
+} MusicRecent;
+
+// Single producer (main thread), single consumer (music thread), indices only ever grow
+static MusicCommand gCommands[MUSIC_COMMANDS];
+static atomic_uint gCommandHead;
+static atomic_uint gCommandTail;
+
+static pthread_t gThread;
+static bool gRunning = false;
+static atomic_bool gStop;
+static atomic_uint gClears; // CMD_CLEAR handled so far
+static atomic_int gOpen;
+static atomic_ulong gRefills;
+static atomic_ulong gLate;
+static _Atomic float gMaxGap;
+static float gVolumeSent = -1.0f; // main thread side
+
+// Everything below is only touched by the music thread
+static MusicVoice gVoices[MUSIC_STREAMS];
+static int gCurrent = 0;
+static MusicRecent gRecent[MUSIC_RECENT];
+static unsigned long gUses = 0;
+static float gVolume = 1.0f;
+
+static void remember(const char *path, float position) {
+    MusicRecent *slot = &gRecent[0];
+    for (int i = 0; i < MUSIC_RECENT; i++) {
+        if (strcmp(gRecent[i].path, path) == 0) {
+            slot = &gRecent[i];
+            break;
+        }
+        if (gRecent[i].used < slot->used) slot = &gRecent[i];
+    }
+    strncpy(slot->path, path, MUSIC_PATH_SIZE - 1);
+    slot->path[MUSIC_PATH_SIZE - 1] = '\0';
+    slot->position = position;
+    slot->used = ++gUses;
+}
+
+static float recall(const char *path) {
+    for (int i = 0; i < MUSIC_RECENT; i++)
+        if (gRecent[i].path[0] && strcmp(gRecent[i].path, path) == 0) return gRecent[i].position;
+    return 0.0f;
+}
+
+static void closeVoice(MusicVoice *voice) {
+    if (!voice->open) return;
+    remember(voice->path, GetMusicTimePlayed(voice->music));
+    StopMusicStream(voice->music);
+    UnloadMusicStream(voice->music);
+    voice->open = false;
+    voice->gain = voice->target = 0.0f;
+    atomic_fetch_sub(&gOpen, 1);
+}
+
+static void playVoice(const char *path, float start) {
+    MusicVoice *current = &gVoices[gCurrent];
+    MusicVoice *other = &gVoices[1 - gCurrent];
+    if (current->open && strcmp(current->path, path) == 0) {
+        current->target = 1.0f;
+        if (start > 0.0f) SeekMusicStream(current->music, start);
+        return;
+    }
+    if (other->open && start <= 0.0f && strcmp(other->path, path) == 0) {
+        // Switching back before the fade finished, bring the outgoing stream back up
+        current->target = 0.0f;
+        other->target = 1.0f;
+        gCurrent = 1 - gCurrent;
+        return;
+    }
+
+    // Only two decoders are ever open, whatever was still fading out is cut
+    closeVoice(other);
+    // A packed track streams from the mapping, which stays valid until shutdown
+    size_t size = 0;
+    const unsigned char *packed = packFind(path, &size);
+    Music music = packed ? LoadMusicStreamFromMemory(GetFileExtension(path), packed, (int)size) : LoadMusicStream(path);
+    if (music.frameCount == 0) {
+        TraceLog(LOG_WARNING, "Failed to open music: %s", path);
+        return;
+    }
+    current->target = 0.0f;
+    other->music = music;
+    other->open = true;
+    other->gain = current->open ? 0.0f : 1.0f;
+    other->target = 1.0f;
+    strncpy(other->path, path, MUSIC_PATH_SIZE - 1);
+    other->path[MUSIC_PATH_SIZE - 1] = '\0';
+    SetMusicVolume(music, other->gain * gVolume);
+    PlayMusicStream(music);
+    if (start > 0.0f) SeekMusicStream(music, start);
+    gCurrent = 1 - gCurrent;
+    atomic_fetch_add(&gOpen, 1);
+}
+
+static void resumeVoice(const char *path) {
+    for (int i = 0; i < MUSIC_STREAMS; i++) {
+        if (gVoices[i].open && strcmp(gVoices[i].path, path) == 0) {
+            playVoice(path, 0.0f);
+            return;
+        }
+    }
+    playVoice(path, recall(path));
+}
+
+// The file changed on disk, a playing track is opened again where it was and one fading out is cut
+static void reloadVoice(const char *path) {
+    for (int i = 0; i < MUSIC_STREAMS; i++) {
+        MusicVoice *voice = &gVoices[i];
+        if (!voice->open || strcmp(voice->path, path) != 0) continue;
+        if (i != gCurrent) {
+            closeVoice(voice);
+            continue;
+        }
+        float position = GetMusicTimePlayed(voice->music);
+        closeVoice(voice);
+        playVoice(path, position);
+        return;
+    }
+}
+
+static void clearVoices(void) {
+    for (int i = 0; i < MUSIC_STREAMS; i++)
+        closeVoice(&gVoices[i]);
+    memset(gRecent, 0, sizeof(gRecent));
+    gCurrent = 0;
+}
+
+static void runCommands(void) {
+    unsigned int tail = atomic_load_explicit(&gCommandTail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&gCommandHead, memory_order_acquire);
+    for (; tail != head; tail++) {
+        MusicCommand *cmd = &gCommands[tail % MUSIC_COMMANDS];
+        switch (cmd->type) {
+            case CMD_PLAY: playVoice(cmd->path, cmd->value); break;
+            case CMD_RESUME: resumeVoice(cmd->path); break;
+            case CMD_STOP: gVoices[gCurrent].target = 0.0f; break;
+            case CMD_VOLUME: gVolume = cmd->value; break;
+            case CMD_RELOAD: reloadVoice(cmd->path); break;
+            case CMD_CLEAR: {
+                clearVoices();
+                atomic_fetch_add(&gClears, 1);
+            } break;
+        }
+        atomic_store_explicit(&gCommandTail, tail + 1, memory_order_release);
+    }
+}
+
+// Advance the fades and top up every open stream's buffers
+static void pumpVoices(float dt) {
+    float step = dt / MUSIC_CROSSFADE;
+    float buffered = 1.0f;
+    bool any = false;
+    for (int i = 0; i < MUSIC_STREAMS; i++) {
+        MusicVoice *voice = &gVoices[i];
+        if (!voice->open) continue;
+        if (voice->gain < voice->target) voice->gain = voice->gain + step < voice->target ? voice->gain + step : voice->target;
+        else if (voice->gain > voice->target) voice->gain = voice->gain - step > voice->target ? voice->gain - step : voice->target;
+        if (voice->gain <= 0.0f && voice->target <= 0.0f) {
+            closeVoice(voice);
+            continue;
+        }
+        SetMusicVolume(voice->music, voice->gain * gVolume);
+        UpdateMusicStream(voice->music);
+        float seconds = 2.0f * MUSIC_BUFFER_FRAMES / (float)voice->music.stream.sampleRate;
+        if (seconds < buffered) buffered = seconds;
+        any = true;
+    }
+    if (!any) return;
+    atomic_fetch_add(&gRefills, 1);
+    if (dt > buffered) atomic_fetch_add(&gLate, 1);
+    if (dt > atomic_load(&gMaxGap)) atomic_store(&gMaxGap, dt);
+}
+
+static void *musicThread(void *arg) {
+    (void)arg;
+    struct timespec pause = { 0, (long)(MUSIC_PUMP_INTERVAL * 1e9) };
+    double last = GetTime();
+    while (!atomic_load(&gStop)) {
+        runCommands();
+        double now = GetTime();
+        pumpVoices((float)(now - last));
+        last = now;
+        nanosleep(&pause, NULL);
+    }
+    runCommands();
+    clearVoices();
+    return NULL;
+}
+
+static bool pushCommand(int type, float value, const char *path) {
+    unsigned int head = atomic_load_explicit(&gCommandHead, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&gCommandTail, memory_order_acquire);
+    if (head - tail == MUSIC_COMMANDS) {
+        TraceLog(LOG_WARNING, "Music command queue is full, dropping request");
+        return false;
+    }
+    MusicCommand *cmd = &gCommands[head % MUSIC_COMMANDS];
+    cmd->type = type;
+    cmd->value = value;
+    cmd->path[0] = '\0';
+    if (path) {
+        strncpy(cmd->path, path, MUSIC_PATH_SIZE - 1);
+        cmd->path[MUSIC_PATH_SIZE - 1] = '\0';
+    }
+    atomic_store_explicit(&gCommandHead, head + 1, memory_order_release);
+    return true;
+}
+
+void musicInit(void) {
+    // Larger than raylib's default so a descheduled music thread still has audio queued
+    SetAudioStreamBufferSizeDefault(MUSIC_BUFFER_FRAMES);
+    atomic_store(&gStop, false);
+    gRunning = pthread_create(&gThread, NULL, musicThread, NULL) == 0;
+    if (!gRunning) TraceLog(LOG_WARNING, "Could not start the music thread");
+}
+
+void musicShutdown(void) {
+    if (!gRunning) return;
+    atomic_store(&gStop, true);
+    pthread_join(gThread, NULL);
+    gRunning = false;
+}
+
+bool musicPlay(const char *path, float start) {
+    return pushCommand(CMD_PLAY, start, path);
+}
+
+bool musicResume(const char *path) {
+    return pushCommand(CMD_RESUME, 0.0f, path);
+}
+
+bool musicReload(const char *path) {
+    return pushCommand(CMD_RELOAD, 0.0f, path);
+}
+
+bool musicStop(void) {
+    return pushCommand(CMD_STOP, 0.0f, NULL);
+}
+
+void musicSetVolume(float volume) {
+    if (volume == gVolumeSent) return;
+    if (pushCommand(CMD_VOLUME, volume, NULL)) gVolumeSent = volume;
+}
+
+int musicOpenStreams(void) {
+    return atomic_load(&gOpen);
+}
+
+MusicStats musicGetStats(void) {
+    MusicStats stats;
+    stats.refills = atomic_load(&gRefills);
+    stats.late = atomic_load(&gLate);
+    stats.maxGap = atomic_load(&gMaxGap);
+    stats.streams = atomic_load(&gOpen);
+    return stats;
+}
+
+void musicClear(void) {
+    if (!gRunning) return;
+    struct timespec pause = { 0, (long)(MUSIC_PUMP_INTERVAL * 1e9) };
+    unsigned int handled = atomic_load(&gClears);
+    while (!pushCommand(CMD_CLEAR, 0.0f, NULL))
+        nanosleep(&pause, NULL);
+    while (atomic_load(&gClears) == handled)
+        nanosleep(&pause, NULL);
+}
@@ -0,0 +1,38 @@
+#ifndef MUSIC_H
+#define MUSIC_H
+#include <stdbool.h>
+
+#define MUSIC_STREAMS 2            // open decoders, the playing track and the one fading out
+#define MUSIC_RECENT 8             // closed tracks remembered by position
+#define MUSIC_CROSSFADE 1.0f       // seconds
+#define MUSIC_PATH_SIZE 512
+#define MUSIC_COMMANDS 32          // queued requests from the main thread, a power of two
+#define MUSIC_BUFFER_FRAMES 8192   // per stream sub-buffer, two are queued ahead of the device
+#define MUSIC_PUMP_INTERVAL 0.005  // seconds the music thread sleeps between refills
+
+typedef struct {
+    unsigned long refills;  // passes of the music thread over the open streams
+    unsigned long late;     // passes that came later than the buffered audio lasts
+    float maxGap;           // longest time between two passes, in seconds
+    int streams;
+} MusicStats;
+
+// Start the thread that owns every music stream, needs the audio device
+extern void musicInit(void);
+extern void musicShutdown(void);
+
+// Requests are queued for the music thread, they only fail when the queue is full
+// Fade over to path from start seconds in, the playing track only seeks
+extern bool musicPlay(const char *path, float start);
+// Like musicPlay, but continue from where the track was when it was last closed
+extern bool musicResume(const char *path);
+// Reopen path if it is playing, after the file was edited
+extern bool musicReload(const char *path);
+extern bool musicStop(void);
+// Overall music volume, only queued when it changes
+extern void musicSetVolume(float volume);
+extern int musicOpenStreams(void);
+extern MusicStats musicGetStats(void);
+// Close every stream and forget recent positions, returns once the music thread has done so
+extern void musicClear(void);
+#endif
@@ -0,0 +1,52 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "outline.h"
+
+// Same result as the old outline shader: the alpha of four diagonal taps size texels away,
+// clamped to one, is the outline coverage and the sprite is blended over it by its own alpha.
+// Taps past the edge read as transparent. The inner loop is plain integer math over contiguous
+// rows so the compiler vectorises it.
+void outlineBake(Image *image, int size, Color color) {
+    if (!image->data || image->format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 || size <= 0) return;
+    int width = image->width, height = image->height;
+    int stride = width + 2 * size;
+
+    // Alpha plane with a transparent border, so every tap is an in-bounds read
+    uint8_t *alpha = calloc((size_t)stride * (height + 2 * size), 1);
+    uint16_t *coverage = malloc(width * sizeof(uint16_t));
+    if (!alpha || !coverage) {
+        free(alpha);
+        free(coverage);
+        TraceLog(LOG_WARNING, "Out of memory baking sprite outline");
+        return;
+    }
+    uint8_t *pixels = image->data;
+    for (int y = 0; y < height; y++) {
+        uint8_t *row = alpha + (size_t)(y + size) * stride + size;
+        const uint8_t *src = pixels + (size_t)y * width * 4;
+        for (int x = 0; x < width; x++)
+            row[x] = src[x * 4 + 3];
+    }
+
+    const uint16_t tint[4] = { color.r, color.g, color.b, color.a };
+    for (int y = 0; y < height; y++) {
+        // Row y of the image is row y + size of the plane, the taps are size rows either side
+        const uint8_t *up = alpha + (size_t)y * stride;
+        const uint8_t *down = alpha + (size_t)(y + 2 * size) * stride;
+        for (int x = 0; x < width; x++) {
+            uint16_t sum = up[x] + up[x + 2 * size] + down[x] + down[x + 2 * size];
+            coverage[x] = sum > 255 ? 255 : sum;
+        }
+        uint8_t *dst = pixels + (size_t)y * width * 4;
+        for (int x = 0; x < width; x++) {
+            uint32_t a = dst[x * 4 + 3];
+            for (int c = 0; c < 4; c++) {
+                uint32_t under = tint[c] * coverage[x] / 255;
+                dst[x * 4 + c] = (uint8_t)((under * (255 - a) + dst[x * 4 + c] * a + 127) / 255);
+            }
+        }
+    }
+    free(alpha);
+    free(coverage);
+}
@@ -0,0 +1,10 @@
+#ifndef OUTLINE_H
+#define OUTLINE_H
+#include <raylib.h>
+
+#define OUTLINE_SIZE 8                              // texels to the corner taps
+#define OUTLINE_COLOR ((Color){ 51, 51, 51, 51 })
+
+// Bake the sprite outline into an RGBA8 image in place, the result draws without a shader
+extern void outlineBake(Image *image, int size, Color color);
+#endif
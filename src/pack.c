@@ -0,0 +1,278 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <raylib.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "pack.h"
+#include "texcache.h"
+
+#define PACK_MAGIC 0x4b504e56 // "VNPK"
+#define PACK_VERSION 1
+#define PACK_PREFIX_SIZE 512
+
+// Header, then the slot table, then the names, then every file's contents
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t slots;    // a power of two, at least twice count
+} PackHeader;
+
+// Open addressing on the path hash, a slot with no name is empty
+typedef struct {
+    uint64_t hash;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t name;     // offset of the path, relative to the module folder
+    uint32_t nameLength;
+} PackSlot;
+
+typedef struct {
+    unsigned int file; // index into the directory listing
+    uint32_t slot;
+} PackItem;
+
+typedef struct Pack {
+    struct Pack *next;
+    char prefix[PACK_PREFIX_SIZE]; // mods/<module>/
+    size_t prefixLength;
+    const unsigned char *base;
+    size_t size;
+    const PackSlot *slots;
+    uint32_t mask;
+    uint32_t count;
+} Pack;
+
+// Decoders may still read from a module's pack after the next one is opened, so none is unmapped before shutdown
+static Pack *gPacks = NULL;
+static _Atomic(Pack *) gCurrent = NULL;
+static atomic_ulong gLookups;
+static atomic_ulong gHits;
+
+static uint64_t hashPath(const char *path, size_t length) {
+    uint64_t hash = 1469598103934665603ull; // FNV-1a
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)path[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static void unmapPack(Pack *pack) {
+#ifdef _WIN32
+    UnloadFileData((unsigned char *)pack->base);
+#else
+    munmap((void *)pack->base, pack->size);
+#endif
+}
+
+// Every slot has to point inside the file and at least half of them must be empty, lookups then only compare and always stop
+static bool validPack(const unsigned char *base, size_t size) {
+    if (size < sizeof(PackHeader)) return false;
+    const PackHeader *header = (const PackHeader *)base;
+    if (header->magic != PACK_MAGIC || header->version != PACK_VERSION) return false;
+    if (header->slots == 0 || (header->slots & (header->slots - 1)) != 0 || header->count > header->slots / 2) return false;
+    if (sizeof(PackHeader) + (uint64_t)header->slots * sizeof(PackSlot) > size) return false;
+    const PackSlot *slots = (const PackSlot *)(base + sizeof(PackHeader));
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < header->slots; i++) {
+        if (slots[i].nameLength == 0) continue;
+        if ((uint64_t)slots[i].name + slots[i].nameLength > size) return false;
+        if (slots[i].offset > size || slots[i].size > size - slots[i].offset) return false;
+        used++;
+    }
+    return used == header->count;
+}
+
+static Pack *mapPack(const char *module) {
+    char path[PACK_PREFIX_SIZE + 32];
+    snprintf(path, sizeof(path), "mods/%s/%s", module, PACK_FILE);
+    const unsigned char *base = NULL;
+    size_t size = 0;
+#ifdef _WIN32
+    // No mmap, the pack is read in once instead
+    int bytes = 0;
+    base = LoadFileData(path, &bytes);
+    size = bytes > 0 ? (size_t)bytes : 0;
+    if (!base) return NULL;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        size = (size_t)st.st_size;
+        void *mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) base = mapping;
+    }
+    close(fd);
+    if (!base) {
+        TraceLog(LOG_WARNING, "Could not map %s", path);
+        return NULL;
+    }
+#endif
+    Pack *pack = malloc(sizeof(Pack));
+    if (!pack || !validPack(base, size)) {
+        TraceLog(LOG_WARNING, "Ignoring invalid pack %s, using loose files", path);
+        free(pack);
+        Pack temp = { .base = base, .size = size };
+        unmapPack(&temp);
+        return NULL;
+    }
+    const PackHeader *header = (const PackHeader *)base;
+    snprintf(pack->prefix, PACK_PREFIX_SIZE, "mods/%s/", module);
+    pack->prefixLength = strlen(pack->prefix);
+    pack->base = base;
+    pack->size = size;
+    pack->slots = (const PackSlot *)(base + sizeof(PackHeader));
+    pack->mask = header->slots - 1;
+    pack->count = header->count;
+    pack->next = gPacks;
+    gPacks = pack;
+    TraceLog(LOG_INFO, "Mapped %s: %u files, %zu bytes", path, pack->count, size);
+    return pack;
+}
+
+bool packOpen(const char *module) {
+    char prefix[PACK_PREFIX_SIZE];
+    snprintf(prefix, PACK_PREFIX_SIZE, "mods/%s/", module);
+    Pack *pack = gPacks;
+    while (pack && strcmp(pack->prefix, prefix) != 0)
+        pack = pack->next;
+    if (!pack) pack = mapPack(module);
+    atomic_store(&gCurrent, pack);
+    return pack != NULL;
+}
+
+const unsigned char *packFind(const char *path, size_t *size) {
+    Pack *pack = atomic_load(&gCurrent);
+    if (!pack) return NULL;
+    atomic_fetch_add_explicit(&gLookups, 1, memory_order_relaxed);
+    if (strncmp(path, pack->prefix, pack->prefixLength) != 0) return NULL;
+    const char *name = path + pack->prefixLength;
+    size_t length = strlen(name);
+    uint64_t hash = hashPath(name, length);
+    uint32_t i = (uint32_t)hash & pack->mask;
+    for (uint32_t probes = 0; probes <= pack->mask; probes++, i = (i + 1) & pack->mask) {
+        const PackSlot *slot = &pack->slots[i];
+        if (slot->nameLength == 0) return NULL;
+        if (slot->hash == hash && slot->nameLength == length && memcmp(pack->base + slot->name, name, length) == 0) {
+            atomic_fetch_add_explicit(&gHits, 1, memory_order_relaxed);
+            *size = (size_t)slot->size;
+            return pack->base + slot->offset;
+        }
+    }
+    return NULL;
+}
+
+// Scripts are compiled from the folder, fonts keep their glyph cache beside them and decoded images are a per machine cache
+static bool packable(const char *path) {
+    const char *name = GetFileName(path);
+    if (strcmp(name, PACK_FILE) == 0) return false;
+    const char *extension = strrchr(name, '.');
+    if (!extension) return true;
+    return strcmp(extension, ".lua") != 0 && strcmp(extension, ".bc") != 0 && strcmp(extension, ".glyphs") != 0 &&
+           strcmp(extension, TEX_CACHE_SUFFIX) != 0 && strcmp(extension, ".tmp") != 0 &&
+           strcmp(extension, ".ttf") != 0 && strcmp(extension, ".otf") != 0;
+}
+
+static bool writePadding(FILE *out, uint64_t *offset) {
+    static const unsigned char zeros[PACK_ALIGN] = { 0 };
+    size_t pad = (size_t)((PACK_ALIGN - *offset % PACK_ALIGN) % PACK_ALIGN);
+    *offset += pad;
+    return pad == 0 || fwrite(zeros, 1, pad, out) == pad;
+}
+
+bool packBuild(const char *module) {
+    char dir[PACK_PREFIX_SIZE];
+    snprintf(dir, PACK_PREFIX_SIZE, "mods/%s", module);
+    if (!DirectoryExists(dir)) {
+        TraceLog(LOG_ERROR, "No module folder %s", dir);
+        return false;
+    }
+    FilePathList files = LoadDirectoryFilesEx(dir, NULL, true);
+    size_t prefixLength = strlen(dir) + 1;
+    uint32_t count = 0;
+    for (unsigned int i = 0; i < files.count; i++)
+        if (packable(files.paths[i])) count++;
+    uint32_t slotCount = 16;
+    while (slotCount < count * 2) slotCount *= 2;
+    PackSlot *slots = calloc(slotCount, sizeof(PackSlot));
+    if (!slots) {
+        UnloadDirectoryFiles(files);
+        return false;
+    }
+
+    char path[PACK_PREFIX_SIZE + 32], temp[PACK_PREFIX_SIZE + 40];
+    snprintf(path, sizeof(path), "%s/%s", dir, PACK_FILE);
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+    FILE *out = fopen(temp, "wb");
+    bool ok = out != NULL;
+    PackHeader header = { PACK_MAGIC, PACK_VERSION, count, slotCount };
+    uint64_t offset = sizeof(PackHeader) + (uint64_t)slotCount * sizeof(PackSlot);
+    // Slots are filled in as the files go by and written over the placeholder at the end
+    ok = ok && fwrite(&header, sizeof(header), 1, out) == 1 && fwrite(slots, sizeof(PackSlot), slotCount, out) == slotCount;
+    PackItem *items = calloc(count ? count : 1, sizeof(PackItem));
+    ok = ok && items;
+    uint32_t packed = 0;
+    for (unsigned int i = 0; ok && i < files.count; i++) {
+        if (!packable(files.paths[i])) continue;
+        const char *name = files.paths[i] + prefixLength;
+        size_t length = strlen(name);
+        ok = offset + length <= UINT32_MAX && fwrite(name, 1, length, out) == length;
+        uint64_t hash = hashPath(name, length);
+        uint32_t slot = (uint32_t)hash & (slotCount - 1);
+        while (slots[slot].nameLength != 0) slot = (slot + 1) & (slotCount - 1);
+        slots[slot] = (PackSlot){ hash, 0, 0, (uint32_t)offset, (uint32_t)length };
+        items[packed++] = (PackItem){ i, slot };
+        offset += length;
+    }
+    for (uint32_t i = 0; ok && i < packed; i++) {
+        int size = 0;
+        unsigned char *data = LoadFileData(files.paths[items[i].file], &size);
+        ok = writePadding(out, &offset) && (size == 0 || (data && fwrite(data, 1, (size_t)size, out) == (size_t)size));
+        UnloadFileData(data);
+        slots[items[i].slot].offset = offset;
+        slots[items[i].slot].size = (uint64_t)size;
+        offset += (uint64_t)size;
+    }
+    ok = ok && fseek(out, sizeof(PackHeader), SEEK_SET) == 0 && fwrite(slots, sizeof(PackSlot), slotCount, out) == slotCount;
+    if (out) ok = fclose(out) == 0 && ok;
+    // Written aside and renamed, a running engine never maps a half written pack
+    ok = ok && rename(temp, path) == 0;
+    if (!ok) {
+        remove(temp);
+        TraceLog(LOG_ERROR, "Failed to write %s", path);
+    } else {
+        TraceLog(LOG_INFO, "Packed %u files of %s into %s, %llu bytes", packed, dir, path, (unsigned long long)offset);
+    }
+    free(items);
+    free(slots);
+    UnloadDirectoryFiles(files);
+    return ok;
+}
+
+void packShutdown(void) {
+    atomic_store(&gCurrent, NULL);
+    while (gPacks) {
+        Pack *next = gPacks->next;
+        unmapPack(gPacks);
+        free(gPacks);
+        gPacks = next;
+    }
+}
+
+PackStats packGetStats(void) {
+    PackStats stats = { atomic_load(&gLookups), atomic_load(&gHits), 0, 0 };
+    Pack *current = atomic_load(&gCurrent);
+    stats.files = current ? current->count : 0;
+    for (Pack *pack = gPacks; pack; pack = pack->next)
+        stats.mappedBytes += pack->size;
+    return stats;
+}
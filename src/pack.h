@@ -0,0 +1,25 @@
+#ifndef PACK_H
+#define PACK_H
+#include <stdbool.h>
+#include <stddef.h>
+
+#define PACK_FILE "assets.pack" // built into mods/<module>/ by make pack, scripts and fonts stay loose files
+#define PACK_ALIGN 16           // file contents start on this boundary inside the pack
+
+typedef struct {
+    unsigned long lookups;
+    unsigned long hits;   // served from the mapping instead of a loose file
+    unsigned int files;   // in the current module's pack
+    size_t mappedBytes;   // every pack mapped this session
+} PackStats;
+
+// Map mods/<module>/assets.pack if there is one, otherwise lookups fall through to loose files
+extern bool packOpen(const char *module);
+// The contents of a file under the current module's folder, read straight from the mapping, NULL when it is not packed
+extern const unsigned char *packFind(const char *path, size_t *size);
+// Write mods/<module>/assets.pack from every asset file under the module's folder
+extern bool packBuild(const char *module);
+// Unmap every pack, only once nothing decodes from them anymore
+extern void packShutdown(void);
+extern PackStats packGetStats(void);
+#endif
@@ -0,0 +1,147 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include "resample.h"
+
+// One RGBA texel in a single SSE or NEON register, GCC and Clang lower the arithmetic on it to vector instructions
+typedef float Texel __attribute__((vector_size(16)));
+typedef int32_t Channels __attribute__((vector_size(16)));
+typedef uint8_t Bytes __attribute__((vector_size(4)));
+
+// The source texels a destination texel covers, each weighted by how much of it falls inside
+typedef struct {
+    int first;
+    int count;
+    int weights; // offset into the weight table
+} Span;
+
+static pthread_mutex_t gStatsLock = PTHREAD_MUTEX_INITIALIZER;
+static ResampleStats gStats = { 0 };
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// A box over the exact footprint, the weights of one span add up to one
+static Span *buildSpans(int source, int target, float **weights) {
+    double scale = (double)source / target;
+    int taps = (int)ceil(scale) + 1;
+    Span *spans = malloc((size_t)target * sizeof(Span));
+    float *table = malloc((size_t)target * taps * sizeof(float));
+    if (!spans || !table) {
+        free(spans);
+        free(table);
+        return NULL;
+    }
+    for (int i = 0; i < target; i++) {
+        double start = i * scale, end = start + scale;
+        int first = (int)start;
+        int last = (int)ceil(end) - 1;
+        if (last >= source) last = source - 1;
+        spans[i] = (Span){ first, last - first + 1, i * taps };
+        for (int j = first; j <= last; j++)
+            table[i * taps + j - first] = (float)((fmin(end, j + 1) - fmax(start, j)) / scale);
+    }
+    *weights = table;
+    return spans;
+}
+
+// Premultiply a source row and shrink it to the destination width
+static void shrinkRow(const uint8_t *src, int sourceWidth, Texel *premultiplied,
+                      const Span *spans, const float *weights, int width, Texel *out) {
+    for (int x = 0; x < sourceWidth; x++) {
+        Bytes bytes;
+        memcpy(&bytes, src + 4 * x, sizeof(bytes));
+        Texel texel = __builtin_convertvector(bytes, Texel);
+        float alpha = texel[3] * (1.0f / 255.0f);
+        premultiplied[x] = texel * (Texel){ alpha, alpha, alpha, 1.0f };
+    }
+    for (int x = 0; x < width; x++) {
+        const Span *span = &spans[x];
+        const float *w = weights + span->weights;
+        Texel sum = { 0 };
+        for (int i = 0; i < span->count; i++)
+            sum += premultiplied[span->first + i] * w[i];
+        out[x] = sum;
+    }
+}
+
+static void storeRow(const Texel *row, int width, uint8_t *dst) {
+    for (int x = 0; x < width; x++) {
+        Texel texel = row[x];
+        float unpremultiply = texel[3] > 0.0f ? 255.0f / texel[3] : 0.0f;
+        Channels channels = __builtin_convertvector(texel * (Texel){ unpremultiply, unpremultiply, unpremultiply, 1.0f } + 0.5f, Channels);
+        Channels over = channels > 255;
+        channels = (channels & ~over) | (255 & over);
+        Bytes bytes = __builtin_convertvector(channels, Bytes);
+        memcpy(dst + 4 * x, &bytes, sizeof(bytes));
+    }
+}
+
+bool resampleImage(Image *image, int width, int height) {
+    if (!image->data || image->format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 || image->mipmaps > 1) return false;
+    if (width < 1 || height < 1 || width > image->width || height > image->height) return false;
+    if (width == image->width && height == image->height) return false;
+    double start = now();
+    float *columnWeights = NULL, *rowWeights = NULL;
+    Span *columns = buildSpans(image->width, width, &columnWeights);
+    Span *rows = buildSpans(image->height, height, &rowWeights);
+    Texel *premultiplied = malloc((size_t)image->width * sizeof(Texel));
+    Texel *shrunk = malloc((size_t)width * sizeof(Texel));
+    Texel *sum = malloc((size_t)width * sizeof(Texel));
+    uint8_t *result = RL_MALLOC((size_t)width * height * 4);
+    bool ok = columns && rows && premultiplied && shrunk && sum && result;
+    const uint8_t *src = image->data;
+    size_t stride = (size_t)image->width * 4;
+    int cached = -1; // a source row straddling two destination rows is shrunk once
+    for (int y = 0; ok && y < height; y++) {
+        const Span *span = &rows[y];
+        memset(sum, 0, (size_t)width * sizeof(Texel));
+        for (int i = 0; i < span->count; i++) {
+            int sy = span->first + i;
+            if (sy != cached) {
+                shrinkRow(src + sy * stride, image->width, premultiplied, columns, columnWeights, width, shrunk);
+                cached = sy;
+            }
+            float w = rowWeights[span->weights + i];
+            for (int x = 0; x < width; x++)
+                sum[x] += shrunk[x] * w;
+        }
+        storeRow(sum, width, result + (size_t)y * width * 4);
+    }
+    free(columns);
+    free(columnWeights);
+    free(rows);
+    free(rowWeights);
+    free(premultiplied);
+    free(shrunk);
+    free(sum);
+    if (!ok) {
+        RL_FREE(result);
+        return false;
+    }
+
+    pthread_mutex_lock(&gStatsLock);
+    gStats.images++;
+    gStats.sourceBytes += stride * image->height;
+    gStats.resultBytes += (size_t)width * height * 4;
+    gStats.time += now() - start;
+    pthread_mutex_unlock(&gStatsLock);
+    RL_FREE(image->data);
+    image->data = result;
+    image->width = width;
+    image->height = height;
+    return true;
+}
+
+ResampleStats resampleGetStats(void) {
+    pthread_mutex_lock(&gStatsLock);
+    ResampleStats stats = gStats;
+    pthread_mutex_unlock(&gStatsLock);
+    return stats;
+}
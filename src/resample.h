@@ -0,0 +1,18 @@
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <raylib.h>
+
+typedef struct {
+    unsigned long images;
+    size_t sourceBytes;  // pixels before resampling
+    size_t resultBytes;  // and after
+    double time;         // seconds spent resampling
+} ResampleStats;
+
+// Shrink an RGBA8 image in place with an area average, false and untouched if it is not smaller or not RGBA8
+// Colour is averaged premultiplied so transparent texels never darken the edges of a sprite
+extern bool resampleImage(Image *image, int width, int height);
+extern ResampleStats resampleGetStats(void);
+#endif
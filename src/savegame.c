@@ -0,0 +1,798 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <raylib.h>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "../external/cc.h"
+#include "intern.h"
+#include "savegame.h"
+
+#define SAVE_MAGIC 0x56534e56 // "VNSV"
+#define SAVE_VERSION 1        // bumped only when a section changes meaning, new sections are skipped by older readers
+#define SAVE_MAX_SECTIONS 16
+#define SAVE_FRAME_SIZE 4096
+#define ENGINE_GLOBALS_KEY "vn.engineglobals"
+
+#define SECTION_TAG(a, b, c, d) ((uint32_t)(a) | (uint32_t)(b) << 8 | (uint32_t)(c) << 16 | (uint32_t)(d) << 24)
+
+enum {
+    SECTION_STRINGS = SECTION_TAG('S', 'T', 'R', 'S'), // every name the other sections refer to, by index from 1
+    SECTION_META = SECTION_TAG('M', 'E', 'T', 'A'),    // module, font and when the save was made
+    SECTION_FRAME = SECTION_TAG('F', 'R', 'A', 'M'),   // the checkpoint on screen, encoded like a history keyframe
+    SECTION_GLOBALS = SECTION_TAG('G', 'L', 'O', 'B'), // script globals
+    SECTION_ENTRY = SECTION_TAG('E', 'N', 'T', 'R'),   // script globals as the saved scene started, for replaying it
+};
+
+enum {
+    VALUE_END,
+    VALUE_FALSE,
+    VALUE_TRUE,
+    VALUE_INTEGER,
+    VALUE_FLOAT,
+    VALUE_STRING,
+    VALUE_TABLE,
+    VALUE_REF, // a table written earlier, shared references and cycles survive the round trip
+};
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t sectionCount;
+} SaveHeader;
+
+typedef struct {
+    uint32_t tag;
+    uint32_t offset; // from the start of the file
+    uint32_t size;
+} SaveSection;
+
+typedef struct {
+    unsigned char *data;
+    size_t len;
+    size_t cap;
+    bool failed;
+} Buffer;
+
+typedef struct {
+    const unsigned char *data;
+    size_t len;
+    size_t pos;
+    bool failed;
+} Reader;
+
+typedef struct {
+    char **strings; // index 0 is unused, like interned id 0
+    int stringCount;
+    int module;
+    int font;
+    int64_t savedAt;
+    HistoryFrame frame;
+    Reader globals;
+    bool hasGlobals;
+    Reader entry;
+    bool hasEntry;
+} ParsedSave;
+
+typedef struct {
+    int slot;
+    unsigned char *data;
+    size_t size;
+} SaveJob;
+
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gJobReady = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t gJobsDone = PTHREAD_COND_INITIALIZER;
+static vec(SaveJob) gJobs;
+static bool gJobsInit = false;
+static bool gWriting = false;
+static bool gStopping = false;
+static bool gRunning = false;
+static pthread_t gThread;
+
+// Main thread only
+static SaveInfo gInfo[SAVE_SLOTS];
+static bool gInfoRead[SAVE_SLOTS];
+
+static void slotPath(char *out, size_t size, int slot) {
+    snprintf(out, size, "%s/slot%d.sav", SAVE_DIR, slot + 1);
+}
+
+static void put(Buffer *b, const void *src, size_t size) {
+    if (b->failed) return;
+    if (b->len + size > b->cap) {
+        size_t cap = b->cap ? b->cap : 1024;
+        while (cap < b->len + size) cap *= 2;
+        unsigned char *data = realloc(b->data, cap);
+        if (!data) {
+            b->failed = true;
+            return;
+        }
+        b->data = data;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, src, size);
+    b->len += size;
+}
+
+static void putByte(Buffer *b, unsigned char byte) {
+    put(b, &byte, 1);
+}
+
+static void putVarint(Buffer *b, uint64_t v) {
+    while (v >= 0x80) {
+        putByte(b, (unsigned char)(v | 0x80));
+        v >>= 7;
+    }
+    putByte(b, (unsigned char)v);
+}
+
+static void putString(Buffer *b, const char *str, size_t length) {
+    putVarint(b, length);
+    put(b, str, length);
+}
+
+static const unsigned char *take(Reader *r, size_t size) {
+    if (r->failed || size > r->len - r->pos) {
+        r->failed = true;
+        return NULL;
+    }
+    const unsigned char *p = r->data + r->pos;
+    r->pos += size;
+    return p;
+}
+
+static unsigned char takeByte(Reader *r) {
+    const unsigned char *p = take(r, 1);
+    return p ? *p : 0;
+}
+
+static uint64_t takeVarint(Reader *r) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        unsigned char b = takeByte(r);
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    r->failed = true;
+    return 0;
+}
+
+// Every string id a frame holds, converted between the session's intern table and the save's string section
+static bool remapFrame(HistoryFrame *frame, int (*convert)(void *ctx, int id), void *ctx) {
+    int *ids[] = { &frame->scene, &frame->lastScene, &frame->script, &frame->background, &frame->music,
+                   &frame->dialogName, &frame->dialogText };
+    for (size_t i = 0; i < sizeof(ids) / sizeof(ids[0]); i++)
+        if ((*ids[i] = convert(ctx, *ids[i])) < 0) return false;
+    for (int i = 0; i < frame->spriteCount; i++) {
+        if ((frame->sprites[i].file = convert(ctx, frame->sprites[i].file)) < 0) return false;
+        if ((frame->sprites[i].id = convert(ctx, frame->sprites[i].id)) < 0) return false;
+    }
+    for (int i = 0; i < frame->choiceCount; i++) {
+        if ((frame->choices[i].text = convert(ctx, frame->choices[i].text)) < 0) return false;
+        if ((frame->choices[i].scene = convert(ctx, frame->choices[i].scene)) < 0) return false;
+    }
+    return true;
+}
+
+// Session id to the index it gets in the save, each string is stored once
+static int toLocal(void *ctx, int id) {
+    vec(int) *ids = ctx;
+    if (id == 0) return 0;
+    for (size_t i = 0; i < size(ids); i++)
+        if (*get(ids, i) == id) return (int)i + 1;
+    push(ids, id);
+    return (int)size(ids);
+}
+
+static int toSession(void *ctx, int id) {
+    const ParsedSave *save = ctx;
+    if (id == 0) return 0;
+    if (id < 0 || id >= save->stringCount) return -1;
+    return internString(save->strings[id]);
+}
+
+/* --- Script globals --- */
+static bool isEngineValue(lua_State *L, int engine, int index) {
+    lua_pushvalue(L, index);
+    bool found = lua_rawget(L, engine) != LUA_TNIL;
+    lua_pop(L, 1);
+    return found;
+}
+
+// Only plain data is saved, functions, userdata and coroutines are recreated by the scripts that made them
+static bool isData(int type) {
+    return type == LUA_TBOOLEAN || type == LUA_TNUMBER || type == LUA_TSTRING || type == LUA_TTABLE;
+}
+
+typedef struct {
+    lua_State *L;
+    Buffer *out;
+    int engine; // engine globals and the tables they hold
+    int seen;   // table to id of every table written so far
+    int tables;
+    int skipped;
+} Snapshot;
+
+static void writeValue(Snapshot *s, int index, int depth);
+
+static bool writableKey(Snapshot *s, int index) {
+    int type = lua_type(s->L, index);
+    return type == LUA_TBOOLEAN || type == LUA_TNUMBER || type == LUA_TSTRING;
+}
+
+static bool writableValue(Snapshot *s, int index, int depth) {
+    int type = lua_type(s->L, index);
+    if (!isData(type)) return false;
+    // A standard library table held by a script is not the script's to save
+    return type != LUA_TTABLE || (depth < SAVE_LUA_DEPTH && !isEngineValue(s->L, s->engine, index));
+}
+
+static void writeFields(Snapshot *s, int table, int depth) {
+    lua_State *L = s->L;
+    lua_pushnil(L);
+    while (lua_next(L, table)) {
+        if (writableKey(s, -2) && writableValue(s, -1, depth)) {
+            writeValue(s, -2, depth);
+            writeValue(s, -1, depth);
+        } else {
+            s->skipped++;
+        }
+        lua_pop(L, 1);
+    }
+    putByte(s->out, VALUE_END);
+}
+
+static void writeValue(Snapshot *s, int index, int depth) {
+    lua_State *L = s->L;
+    index = lua_absindex(L, index);
+    switch (lua_type(L, index)) {
+        case LUA_TBOOLEAN: {
+            putByte(s->out, lua_toboolean(L, index) ? VALUE_TRUE : VALUE_FALSE);
+        } break;
+        case LUA_TNUMBER: {
+            if (lua_isinteger(L, index)) {
+                lua_Integer v = lua_tointeger(L, index);
+                putByte(s->out, VALUE_INTEGER);
+                putVarint(s->out, (uint64_t)v << 1 ^ (uint64_t)(v >> 63)); // zigzag, small negatives stay short
+            } else {
+                double v = lua_tonumber(L, index);
+                putByte(s->out, VALUE_FLOAT);
+                put(s->out, &v, sizeof(v));
+            }
+        } break;
+        case LUA_TSTRING: {
+            size_t length;
+            const char *str = lua_tolstring(L, index, &length);
+            putByte(s->out, VALUE_STRING);
+            putString(s->out, str, length);
+        } break;
+        case LUA_TTABLE: {
+            lua_pushvalue(L, index);
+            if (lua_rawget(L, s->seen) == LUA_TNUMBER) {
+                putByte(s->out, VALUE_REF);
+                putVarint(s->out, (uint64_t)lua_tointeger(L, -1));
+                lua_pop(L, 1);
+                break;
+            }
+            lua_pop(L, 1);
+            if (!lua_checkstack(L, 4)) {
+                s->out->failed = true;
+                break;
+            }
+            lua_pushvalue(L, index);
+            lua_pushinteger(L, ++s->tables);
+            lua_rawset(L, s->seen);
+            putByte(s->out, VALUE_TABLE);
+            writeFields(s, index, depth + 1);
+        } break;
+    }
+}
+
+// Every global a script assigned, raw so metatables neither run nor get saved
+static int writeGlobals(lua_State *L, Buffer *out) {
+    lua_getfield(L, LUA_REGISTRYINDEX, ENGINE_GLOBALS_KEY);
+    int engine = lua_gettop(L);
+    if (!lua_istable(L, engine)) {
+        lua_pop(L, 1);
+        putByte(out, VALUE_END);
+        return 0;
+    }
+    lua_newtable(L);
+    Snapshot s = { L, out, engine, lua_gettop(L), 0, 0 };
+    lua_pushglobaltable(L);
+    int globals = lua_gettop(L);
+    lua_pushnil(L);
+    while (lua_next(L, globals)) {
+        if (lua_type(L, -2) == LUA_TSTRING && !isEngineValue(L, engine, -2)) {
+            if (writableValue(&s, -1, 0)) {
+                writeValue(&s, -2, 0);
+                writeValue(&s, -1, 0);
+            } else {
+                s.skipped++;
+            }
+        }
+        lua_pop(L, 1);
+    }
+    putByte(out, VALUE_END);
+    lua_pop(L, 3);
+    return s.skipped;
+}
+
+static bool readValue(Reader *r, lua_State *L, int tables, int depth);
+
+static bool readFields(Reader *r, lua_State *L, int tables, int depth) {
+    int table = lua_gettop(L);
+    for (;;) {
+        if (r->pos < r->len && r->data[r->pos] == VALUE_END) {
+            r->pos++;
+            return true;
+        }
+        if (!readValue(r, L, tables, depth)) return false;
+        if (!readValue(r, L, tables, depth)) {
+            lua_pop(L, 1);
+            return false;
+        }
+        // nil never comes out of readValue, NaN would make rawset raise an error
+        if (lua_type(L, -2) == LUA_TNUMBER && lua_tonumber(L, -2) != lua_tonumber(L, -2)) {
+            lua_pop(L, 2);
+            return false;
+        }
+        lua_rawset(L, table);
+    }
+}
+
+// Push one value, nothing is left on the stack when it fails
+static bool readValue(Reader *r, lua_State *L, int tables, int depth) {
+    if (!lua_checkstack(L, 4)) return false;
+    switch (takeByte(r)) {
+        case VALUE_FALSE: lua_pushboolean(L, 0); break;
+        case VALUE_TRUE: lua_pushboolean(L, 1); break;
+        case VALUE_INTEGER: {
+            uint64_t v = takeVarint(r);
+            lua_pushinteger(L, (lua_Integer)(v >> 1 ^ (~(v & 1) + 1)));
+        } break;
+        case VALUE_FLOAT: {
+            const unsigned char *p = take(r, sizeof(double));
+            double v = 0;
+            if (p) memcpy(&v, p, sizeof(v));
+            lua_pushnumber(L, v);
+        } break;
+        case VALUE_STRING: {
+            uint64_t length = takeVarint(r);
+            const unsigned char *p = take(r, length);
+            if (!p) return false;
+            lua_pushlstring(L, (const char *)p, length);
+        } break;
+        case VALUE_TABLE: {
+            if (depth >= SAVE_LUA_DEPTH) return false;
+            lua_newtable(L);
+            lua_pushvalue(L, -1);
+            lua_rawseti(L, tables, (lua_Integer)lua_rawlen(L, tables) + 1);
+            if (!readFields(r, L, tables, depth + 1)) {
+                lua_pop(L, 1);
+                return false;
+            }
+        } break;
+        case VALUE_REF: {
+            uint64_t id = takeVarint(r);
+            if (r->failed || id == 0 || id > lua_rawlen(L, tables)) return false;
+            lua_rawgeti(L, tables, (lua_Integer)id);
+        } break;
+        default: return false;
+    }
+    if (r->failed) {
+        lua_pop(L, 1);
+        return false;
+    }
+    return true;
+}
+
+// Swap the script globals for the saved ones, functions scripts defined are kept
+static void replaceGlobals(lua_State *L, int saved) {
+    lua_getfield(L, LUA_REGISTRYINDEX, ENGINE_GLOBALS_KEY);
+    int engine = lua_gettop(L);
+    lua_pushglobaltable(L);
+    int globals = lua_gettop(L);
+    lua_pushnil(L);
+    while (lua_next(L, globals)) {
+        // Clearing a field that exists is allowed during traversal
+        if (lua_type(L, -2) == LUA_TSTRING && !isEngineValue(L, engine, -2) && isData(lua_type(L, -1))) {
+            lua_pushvalue(L, -2);
+            lua_pushnil(L);
+            lua_rawset(L, globals);
+        }
+        lua_pop(L, 1);
+    }
+    lua_pushnil(L);
+    while (lua_next(L, saved)) {
+        if (lua_type(L, -2) == LUA_TSTRING && !isEngineValue(L, engine, -2)) {
+            lua_pushvalue(L, -2);
+            lua_pushvalue(L, -2);
+            lua_rawset(L, globals);
+        }
+        lua_pop(L, 1);
+    }
+    lua_pop(L, 2);
+}
+
+unsigned char *saveGameEncodeGlobals(lua_State *L, size_t *size) {
+    Buffer out = { 0 };
+    writeGlobals(L, &out);
+    if (out.failed) {
+        free(out.data);
+        out.data = NULL;
+    }
+    *size = out.data ? out.len : 0;
+    return out.data;
+}
+
+bool saveGameDecodeGlobals(lua_State *L, const unsigned char *data, size_t size) {
+    int top = lua_gettop(L);
+    lua_newtable(L);
+    int tables = lua_gettop(L);
+    lua_newtable(L);
+    Reader r = { data, size, 0, false };
+    bool ok = readFields(&r, L, tables, 0);
+    if (ok) replaceGlobals(L, lua_gettop(L));
+    lua_settop(L, top);
+    return ok;
+}
+
+void saveGameMarkGlobals(lua_State *L) {
+    lua_newtable(L);
+    lua_pushglobaltable(L);
+    lua_pushvalue(L, -1);
+    lua_pushboolean(L, 1);
+    lua_rawset(L, -4);
+    lua_pushnil(L);
+    while (lua_next(L, -2)) {
+        // The name, and a library table under it so a script holding that table does not save it
+        lua_pushvalue(L, -2);
+        lua_pushboolean(L, 1);
+        lua_rawset(L, -6);
+        if (lua_istable(L, -1)) {
+            lua_pushboolean(L, 1);
+            lua_rawset(L, -5);
+        } else {
+            lua_pop(L, 1);
+        }
+    }
+    lua_pop(L, 1);
+    lua_setfield(L, LUA_REGISTRYINDEX, ENGINE_GLOBALS_KEY);
+}
+
+/* --- File --- */
+static void makeSaveDir(void) {
+#ifdef _WIN32
+    _mkdir(SAVE_DIR);
+#else
+    mkdir(SAVE_DIR, 0755);
+#endif
+}
+
+static bool writeSlot(int slot, const unsigned char *data, size_t size) {
+    char path[SAVE_PATH_SIZE], temp[SAVE_PATH_SIZE + 8];
+    slotPath(path, sizeof(path), slot);
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+    makeSaveDir();
+    FILE *out = fopen(temp, "wb");
+    if (!out) return false;
+    bool ok = fwrite(data, 1, size, out) == size && fflush(out) == 0;
+#ifndef _WIN32
+    // On disk before the rename, otherwise a crash can leave the slot naming a file with nothing in it
+    ok = ok && fsync(fileno(out)) == 0;
+#endif
+    ok = fclose(out) == 0 && ok;
+#ifdef _WIN32
+    // rename does not replace an existing file here
+    if (ok) remove(path);
+#endif
+    if (!ok || rename(temp, path) != 0) {
+        remove(temp);
+        return false;
+    }
+#ifndef _WIN32
+    int dir = open(SAVE_DIR, O_RDONLY);
+    if (dir >= 0) {
+        fsync(dir);
+        close(dir);
+    }
+#endif
+    return true;
+}
+
+static void *saveThread(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&gLock);
+    for (;;) {
+        while (size(&gJobs) == 0 && !gStopping)
+            pthread_cond_wait(&gJobReady, &gLock);
+        if (size(&gJobs) == 0) break;
+        SaveJob job = *get(&gJobs, 0);
+        erase(&gJobs, 0);
+        gWriting = true;
+        pthread_mutex_unlock(&gLock);
+        if (!writeSlot(job.slot, job.data, job.size))
+            TraceLog(LOG_WARNING, "Could not write save slot %d: %s", job.slot + 1, strerror(errno));
+        free(job.data);
+        pthread_mutex_lock(&gLock);
+        gWriting = false;
+        pthread_cond_broadcast(&gJobsDone);
+    }
+    pthread_mutex_unlock(&gLock);
+    return NULL;
+}
+
+static void waitForWrites(void) {
+    if (!gRunning) return;
+    pthread_mutex_lock(&gLock);
+    while (size(&gJobs) > 0 || gWriting)
+        pthread_cond_wait(&gJobsDone, &gLock);
+    pthread_mutex_unlock(&gLock);
+}
+
+static bool queueWrite(int slot, unsigned char *data, size_t length) {
+    pthread_mutex_lock(&gLock);
+    if (!gJobsInit) {
+        init(&gJobs);
+        gJobsInit = true;
+    }
+    if (!gRunning) {
+        gStopping = false;
+        gRunning = pthread_create(&gThread, NULL, saveThread, NULL) == 0;
+    }
+    bool queued = false;
+    // Saving to a slot twice before the first write started only writes the second
+    for (size_t i = 0; !queued && i < size(&gJobs); i++) {
+        SaveJob *job = get(&gJobs, i);
+        if (job->slot != slot) continue;
+        free(job->data);
+        job->data = data;
+        job->size = length;
+        queued = true;
+    }
+    if (!queued && gRunning) queued = push(&gJobs, ((SaveJob){ slot, data, length })) != NULL;
+    if (queued) pthread_cond_signal(&gJobReady);
+    pthread_mutex_unlock(&gLock);
+    if (!queued) free(data);
+    return queued;
+}
+
+static void addSection(Buffer *file, SaveSection *sections, int *count, uint32_t tag, const Buffer *section) {
+    sections[*count] = (SaveSection){ tag, (uint32_t)file->len, (uint32_t)section->len };
+    (*count)++;
+    put(file, section->data, section->len);
+    if (section->failed) file->failed = true;
+}
+
+bool saveGameWrite(int slot, lua_State *L, const SaveState *state) {
+    if (slot < 0 || slot >= SAVE_SLOTS) return false;
+    double start = GetTime();
+    vec(int) ids;
+    init(&ids);
+    HistoryFrame frame = state->frame;
+    remapFrame(&frame, toLocal, &ids);
+    int module = toLocal(&ids, state->module);
+    int font = toLocal(&ids, state->font);
+    unsigned char encoded[SAVE_FRAME_SIZE];
+    size_t encodedSize = historyEncode(&frame, encoded, sizeof(encoded));
+
+    Buffer strings = { 0 }, meta = { 0 }, globals = { 0 }, file = { 0 };
+    putVarint(&strings, size(&ids));
+    for_each(&ids, id) {
+        const char *str = internLookup(*id);
+        putString(&strings, str, strlen(str));
+    }
+    cleanup(&ids);
+    int64_t savedAt = (int64_t)time(NULL);
+    putVarint(&meta, (uint64_t)module);
+    putVarint(&meta, (uint64_t)font);
+    putVarint(&meta, (uint64_t)savedAt);
+    int skipped = writeGlobals(L, &globals);
+
+    SaveSection sections[SAVE_MAX_SECTIONS];
+    int count = 0;
+    SaveHeader header = { SAVE_MAGIC, SAVE_VERSION, state->entry ? 5 : 4 };
+    size_t tableOffset = sizeof(header);
+    put(&file, &header, sizeof(header));
+    put(&file, sections, header.sectionCount * sizeof(SaveSection)); // filled in below
+    addSection(&file, sections, &count, SECTION_STRINGS, &strings);
+    addSection(&file, sections, &count, SECTION_META, &meta);
+    addSection(&file, sections, &count, SECTION_FRAME, &(Buffer){ encoded, encodedSize, encodedSize, encodedSize == 0 });
+    addSection(&file, sections, &count, SECTION_GLOBALS, &globals);
+    if (state->entry)
+        addSection(&file, sections, &count, SECTION_ENTRY, &(Buffer){ (unsigned char *)state->entry, state->entrySize, state->entrySize, false });
+    free(strings.data);
+    free(meta.data);
+    free(globals.data);
+    if (file.failed || file.len > UINT32_MAX) {
+        free(file.data);
+        TraceLog(LOG_WARNING, "Could not encode save slot %d", slot + 1);
+        return false;
+    }
+    memcpy(file.data + tableOffset, sections, count * sizeof(SaveSection));
+    size_t fileSize = file.len;
+    if (!queueWrite(slot, file.data, fileSize)) {
+        TraceLog(LOG_WARNING, "Could not start writing save slot %d", slot + 1);
+        return false;
+    }
+
+    SaveInfo *info = &gInfo[slot];
+    *info = (SaveInfo){ .used = true, .savedAt = savedAt, .line = state->frame.line };
+    strncpy(info->module, internLookup(state->module), SAVE_NAME_SIZE - 1);
+    strncpy(info->scene, internLookup(state->frame.scene), SAVE_NAME_SIZE - 1);
+    gInfoRead[slot] = true;
+    TraceLog(LOG_INFO, "Saving slot %d: %zu bytes, encoded in %.2f ms%s", slot + 1, fileSize,
+             (GetTime() - start) * 1000.0, skipped ? TextFormat(", %d non-data globals left out", skipped) : "");
+    return true;
+}
+
+static unsigned char *readFile(const char *path, size_t *length) {
+    FILE *in = fopen(path, "rb");
+    if (!in) return NULL;
+    unsigned char *data = NULL;
+    long size = fseek(in, 0, SEEK_END) == 0 ? ftell(in) : -1;
+    if (size > 0 && fseek(in, 0, SEEK_SET) == 0) data = malloc(size);
+    if (data && fread(data, 1, size, in) != (size_t)size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(in);
+    *length = data ? (size_t)size : 0;
+    return data;
+}
+
+static void freeParsed(ParsedSave *save) {
+    for (int i = 1; i < save->stringCount; i++)
+        free(save->strings[i]);
+    free(save->strings);
+    save->strings = NULL;
+    save->stringCount = 0;
+}
+
+// Check the header and section table and decode everything except the globals, which are left to the caller
+static bool parseSave(const unsigned char *data, size_t length, ParsedSave *save) {
+    memset(save, 0, sizeof(*save));
+    SaveHeader header;
+    if (length < sizeof(header)) return false;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != SAVE_MAGIC || header.version != SAVE_VERSION || header.sectionCount > SAVE_MAX_SECTIONS ||
+        length < sizeof(header) + header.sectionCount * sizeof(SaveSection)) return false;
+    SaveSection sections[SAVE_MAX_SECTIONS];
+    memcpy(sections, data + sizeof(header), header.sectionCount * sizeof(SaveSection));
+    Reader strings = { 0 }, meta = { 0 }, frame = { 0 };
+    bool hasStrings = false, hasMeta = false, hasFrame = false;
+    for (uint32_t i = 0; i < header.sectionCount; i++) {
+        SaveSection *section = &sections[i];
+        if (section->offset > length || section->size > length - section->offset) return false;
+        Reader r = { data + section->offset, section->size, 0, false };
+        switch (section->tag) {
+            case SECTION_STRINGS: strings = r; hasStrings = true; break;
+            case SECTION_META: meta = r; hasMeta = true; break;
+            case SECTION_FRAME: frame = r; hasFrame = true; break;
+            case SECTION_GLOBALS: save->globals = r; save->hasGlobals = true; break;
+            case SECTION_ENTRY: save->entry = r; save->hasEntry = true; break;
+            default: break; // written by a newer engine, nothing here needs it
+        }
+    }
+    if (!hasStrings || !hasMeta || !hasFrame) return false;
+
+    uint64_t count = takeVarint(&strings);
+    if (strings.failed || count > strings.len) return false;
+    save->strings = calloc(count + 1, sizeof(char *));
+    if (!save->strings) return false;
+    save->stringCount = 1;
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t size = takeVarint(&strings);
+        const unsigned char *p = take(&strings, size);
+        char *str = p ? malloc(size + 1) : NULL;
+        if (!str) {
+            freeParsed(save);
+            return false;
+        }
+        memcpy(str, p, size);
+        str[size] = '\0';
+        save->strings[save->stringCount++] = str;
+    }
+    save->module = (int)takeVarint(&meta);
+    save->font = (int)takeVarint(&meta);
+    save->savedAt = (int64_t)takeVarint(&meta);
+    if (meta.failed || save->module < 0 || save->module >= save->stringCount || save->font < 0 ||
+        save->font >= save->stringCount || !historyDecode(frame.data, frame.len, &save->frame)) {
+        freeParsed(save);
+        return false;
+    }
+    return true;
+}
+
+bool saveGameRead(int slot, lua_State *L, SaveState *state) {
+    if (slot < 0 || slot >= SAVE_SLOTS) return false;
+    // A write to this slot may still be queued
+    waitForWrites();
+    char path[SAVE_PATH_SIZE];
+    slotPath(path, sizeof(path), slot);
+    size_t length;
+    unsigned char *data = readFile(path, &length);
+    ParsedSave save;
+    if (!data || !parseSave(data, length, &save)) {
+        free(data);
+        TraceLog(LOG_WARNING, "Save slot %d is missing or unreadable", slot + 1);
+        return false;
+    }
+
+    int top = lua_gettop(L);
+    lua_newtable(L); // tables by id for VALUE_REF
+    int tables = lua_gettop(L);
+    lua_newtable(L);
+    bool ok = !save.hasGlobals || readFields(&save.globals, L, tables, 0);
+    HistoryFrame frame = save.frame;
+    ok = ok && remapFrame(&frame, toSession, &save);
+    unsigned char *entry = NULL;
+    if (ok && save.hasEntry && (entry = malloc(save.entry.len ? save.entry.len : 1)))
+        memcpy(entry, save.entry.data, save.entry.len);
+    if (ok) {
+        replaceGlobals(L, lua_gettop(L));
+        state->module = toSession(&save, save.module);
+        state->font = toSession(&save, save.font);
+        state->frame = frame;
+        state->entry = entry;
+        state->entrySize = entry ? save.entry.len : 0;
+    } else {
+        TraceLog(LOG_WARNING, "Save slot %d is corrupt", slot + 1);
+    }
+    lua_settop(L, top);
+    freeParsed(&save);
+    free(data);
+    return ok;
+}
+
+bool saveGameInfo(int slot, SaveInfo *info) {
+    if (slot < 0 || slot >= SAVE_SLOTS) return false;
+    if (!gInfoRead[slot]) {
+        gInfoRead[slot] = true;
+        gInfo[slot] = (SaveInfo){ 0 };
+        char path[SAVE_PATH_SIZE];
+        slotPath(path, sizeof(path), slot);
+        size_t length;
+        unsigned char *data = readFile(path, &length);
+        ParsedSave save;
+        if (data && parseSave(data, length, &save)) {
+            SaveInfo *out = &gInfo[slot];
+            out->used = true;
+            out->savedAt = save.savedAt;
+            out->line = save.frame.line;
+            if (save.module) strncpy(out->module, save.strings[save.module], SAVE_NAME_SIZE - 1);
+            if (save.frame.scene > 0 && save.frame.scene < save.stringCount)
+                strncpy(out->scene, save.strings[save.frame.scene], SAVE_NAME_SIZE - 1);
+            freeParsed(&save);
+        }
+        free(data);
+    }
+    *info = gInfo[slot];
+    return info->used;
+}
+
+void saveGameShutdown(void) {
+    if (gRunning) {
+        waitForWrites();
+        pthread_mutex_lock(&gLock);
+        gStopping = true;
+        pthread_cond_signal(&gJobReady);
+        pthread_mutex_unlock(&gLock);
+        pthread_join(gThread, NULL);
+        gRunning = false;
+    }
+    if (gJobsInit) {
+        cleanup(&gJobs);
+        gJobsInit = false;
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef SAVEGAME_H
+#define SAVEGAME_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "history.h"
+#include "../build/lua/lua.h"
+
+#define SAVE_DIR "saves"
+#define SAVE_SLOTS 6
+#define SAVE_PATH_SIZE 512
+#define SAVE_NAME_SIZE 128
+#define SAVE_LUA_DEPTH 64 // tables nested deeper than this are left out of the snapshot
+
+// What the menus show for a slot, read from the file once and kept up to date by saveGameWrite
+typedef struct {
+    bool used;
+    int64_t savedAt; // unix time
+    int line;
+    char module[SAVE_NAME_SIZE];
+    char scene[SAVE_NAME_SIZE];
+} SaveInfo;
+
+// The visible state of a save, every string an interned id of this session
+typedef struct {
+    int module;
+    int font; // 0 for raylib's built in font
+    HistoryFrame frame;
+    // Globals as the scene started, from saveGameEncodeGlobals, NULL for a save made before they were kept
+    // saveGameRead hands back a copy for the caller to free
+    const unsigned char *entry;
+    size_t entrySize;
+} SaveState;
+
+// Remember which globals belong to the engine and the standard library, everything assigned later is saved
+extern void saveGameMarkGlobals(lua_State *L);
+// Encode the state and a snapshot of the script globals on the calling thread, the file is written on the save thread
+// Writes go to a temporary file that is synced and renamed over the slot, a crash leaves the old save intact
+extern bool saveGameWrite(int slot, lua_State *L, const SaveState *state);
+// Read a slot back, the script globals are only replaced once the whole file has been read without error
+extern bool saveGameRead(int slot, lua_State *L, SaveState *state);
+// The script globals on their own, encoded like a save's globals, NULL when they do not fit in memory
+extern unsigned char *saveGameEncodeGlobals(lua_State *L, size_t *size);
+// Put back globals from saveGameEncodeGlobals, left as they are when the data does not decode
+extern bool saveGameDecodeGlobals(lua_State *L, const unsigned char *data, size_t size);
+extern bool saveGameInfo(int slot, SaveInfo *info);
+// Wait for every queued write and stop the save thread
+extern void saveGameShutdown(void);
+#endif
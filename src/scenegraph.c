@@ -0,0 +1,210 @@
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <raylib.h>
+#include "../external/cc.h"
+#include "scenegraph.h"
+
+#define LITERAL_SIZE 256
+
+typedef struct {
+    SceneAssetKind kind;
+    char *file;
+} SceneAsset;
+
+typedef struct {
+    vec(SceneAsset) assets;
+    vec(char *) next;
+} SceneNode;
+
+static map(char *, SceneNode) gScenes;
+static bool gScenesInit = false;
+
+static SceneNode *getNode(const char *scene) {
+    if (!gScenesInit) {
+        init(&gScenes);
+        gScenesInit = true;
+    }
+    SceneNode *node = get(&gScenes, (char *)scene);
+    if (node) return node;
+    SceneNode empty;
+    init(&empty.assets);
+    init(&empty.next);
+    return insert(&gScenes, strdup(scene), empty);
+}
+
+static void addAsset(SceneNode *node, SceneAssetKind kind, const char *file) {
+    for_each(&node->assets, el)
+        if (el->kind == kind && strcmp(el->file, file) == 0) return;
+    push(&node->assets, ((SceneAsset){ kind, strdup(file) }));
+}
+
+static void addEdge(SceneNode *node, const char *scene) {
+    for_each(&node->next, el)
+        if (strcmp(*el, scene) == 0) return;
+    push(&node->next, strdup(scene));
+}
+
+static const char *skipSpace(const char *p) {
+    while (*p && isspace((unsigned char)*p)) p++;
+    return p;
+}
+
+// Skip a comment starting at "--", handles both line and long bracket comments
+static const char *skipComment(const char *p) {
+    p += 2;
+    if (p[0] == '[' && p[1] == '[') {
+        const char *close = strstr(p, "]]");
+        return close ? close + 2 : p + strlen(p);
+    }
+    while (*p && *p != '\n') p++;
+    return p;
+}
+
+// Copy the quoted literal at p into out, returns the position after it or NULL if p is not a literal
+static const char *readLiteral(const char *p, char *out, size_t size) {
+    char quote = *p;
+    if (quote != '"' && quote != '\'') return NULL;
+    size_t len = 0;
+    for (p++; *p && *p != quote; p++) {
+        if (*p == '\\' && p[1]) p++;
+        if (len + 1 < size) out[len++] = *p;
+    }
+    out[len] = '\0';
+    return *p ? p + 1 : p;
+}
+
+// Literal first argument of a call, f("x", ...) or f "x", an opened paren is counted into depth
+static const char *readCallLiteral(const char *p, char *out, size_t size, int *depth) {
+    p = skipSpace(p);
+    bool paren = *p == '(';
+    if (paren) p = skipSpace(p + 1);
+    const char *after = readLiteral(p, out, size);
+    if (after && paren) (*depth)++;
+    return after;
+}
+
+static void scanSource(SceneNode *node, const char *src) {
+    char literal[LITERAL_SIZE];
+    int depth = 0;
+    int choicesDepth = -1;
+    const char *p = src;
+    while (*p) {
+        if (p[0] == '-' && p[1] == '-') {
+            p = skipComment(p);
+        } else if (*p == '"' || *p == '\'') {
+            p = readLiteral(p, literal, sizeof(literal));
+        } else if (*p == '(') {
+            depth++;
+            p++;
+        } else if (*p == ')') {
+            if (--depth < choicesDepth) choicesDepth = -1;
+            p++;
+        } else if (isalpha((unsigned char)*p) || *p == '_') {
+            const char *start = p;
+            while (isalnum((unsigned char)*p) || *p == '_') p++;
+            size_t len = p - start;
+            const char *after = NULL;
+            if (len == 15 && strncmp(start, "load_background", len) == 0) {
+                if ((after = readCallLiteral(p, literal, sizeof(literal), &depth))) addAsset(node, SCENE_BACKGROUND, literal);
+            } else if (len == 11 && strncmp(start, "load_sprite", len) == 0) {
+                if ((after = readCallLiteral(p, literal, sizeof(literal), &depth))) addAsset(node, SCENE_SPRITE, literal);
+            } else if (len == 10 && strncmp(start, "play_music", len) == 0) {
+                if ((after = readCallLiteral(p, literal, sizeof(literal), &depth))) addAsset(node, SCENE_MUSIC, literal);
+            } else if (len == 11 && strncmp(start, "set_choices", len) == 0) {
+                if (*skipSpace(p) == '(') choicesDepth = depth + 1;
+            } else if (len == 5 && strncmp(start, "scene", len) == 0 && choicesDepth != -1) {
+                const char *q = skipSpace(p);
+                if (*q == '=' && q[1] != '=' && (after = readLiteral(skipSpace(q + 1), literal, sizeof(literal))))
+                    addEdge(node, literal);
+            }
+            if (after) p = after;
+        } else {
+            p++;
+        }
+    }
+}
+
+void sceneGraphScan(const char *scene, const char *path) {
+    char *src = LoadFileText(path);
+    if (!src) return;
+    scanSource(getNode(scene), src);
+    UnloadFileText(src);
+}
+
+void sceneGraphRescan(const char *scene, const char *path) {
+    SceneNode *node = getNode(scene);
+    for_each(&node->assets, el) free(el->file);
+    for_each(&node->next, el) free(*el);
+    clear(&node->assets);
+    clear(&node->next);
+    sceneGraphScan(scene, path);
+}
+
+void sceneGraphBuild(const char *module) {
+    sceneGraphClear();
+    const char *dir = TextFormat("mods/%s", module);
+    if (!DirectoryExists(dir)) return;
+    FilePathList files = LoadDirectoryFilesEx(dir, ".lua", false);
+    for (unsigned int i = 0; i < files.count; i++)
+        sceneGraphScan(GetFileName(files.paths[i]), files.paths[i]);
+    TraceLog(LOG_INFO, "Built scene graph for %s: %u scenes", module, files.count);
+    UnloadDirectoryFiles(files);
+}
+
+void sceneGraphClear(void) {
+    if (!gScenesInit) return;
+    for_each(&gScenes, key, node) {
+        for_each(&node->assets, el) free(el->file);
+        for_each(&node->next, el) free(*el);
+        cleanup(&node->assets);
+        cleanup(&node->next);
+        free(*key);
+    }
+    cleanup(&gScenes);
+}
+
+void sceneGraphPrefetch(const char *scene, int depth, SceneWarmFn warm) {
+    if (!gScenesInit || !get(&gScenes, (char *)scene)) return;
+    // Breadth first so nearer scenes are queued for decoding first
+    set(char *) seen;
+    vec(char *) frontier;
+    vec(char *) upcoming;
+    init(&seen);
+    init(&frontier);
+    init(&upcoming);
+    insert(&seen, (char *)scene);
+    push(&frontier, (char *)scene);
+    for (int d = 0; d <= depth && size(&frontier) > 0; d++) {
+        for_each(&frontier, name) {
+            SceneNode *node = get(&gScenes, *name);
+            if (!node) continue;
+            for_each(&node->assets, el) warm(el->kind, el->file);
+            for_each(&node->next, target) {
+                if (get(&seen, *target)) continue;
+                insert(&seen, *target);
+                push(&upcoming, *target);
+            }
+        }
+        clear(&frontier);
+        for_each(&upcoming, name) push(&frontier, *name);
+        clear(&upcoming);
+    }
+    cleanup(&seen);
+    cleanup(&frontier);
+    cleanup(&upcoming);
+}
+
+void sceneGraphDump(FILE *out) {
+    static const char *kindNames[] = { "background", "sprite", "music" };
+    fprintf(out, "digraph scenes {\n");
+    if (gScenesInit) {
+        for_each(&gScenes, key, node) {
+            fprintf(out, "    \"%s\" [label=\"%s", *key, *key);
+            for_each(&node->assets, el) fprintf(out, "\\n%s: %s", kindNames[el->kind], el->file);
+            fprintf(out, "\"];\n");
+            for_each(&node->next, target) fprintf(out, "    \"%s\" -> \"%s\";\n", *key, *target);
+        }
+    }
+    fprintf(out, "}\n");
+}
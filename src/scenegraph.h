@@ -0,0 +1,29 @@
+#ifndef SCENEGRAPH_H
+#define SCENEGRAPH_H
+#include <stdio.h>
+
+#define PREFETCH_DEPTH 2 // transitions ahead of the current scene to warm
+
+typedef enum {
+    SCENE_BACKGROUND,
+    SCENE_SPRITE,
+    SCENE_MUSIC,
+} SceneAssetKind;
+
+// Called for every asset of a reachable scene, file is relative to the module's asset folders
+typedef void (*SceneWarmFn)(SceneAssetKind kind, const char *file);
+
+// Scan every scene file in mods/<module>/ for literal asset loads and set_choices targets
+extern void sceneGraphBuild(const char *module);
+// Scan a single scene file, used for entry scripts that live outside the module folder
+extern void sceneGraphScan(const char *scene, const char *path);
+// Forget what a scene was scanned to hold and scan it again, after its file was edited
+extern void sceneGraphRescan(const char *scene, const char *path);
+extern void sceneGraphClear(void);
+
+// Warm the assets of every scene reachable from scene within depth transitions
+extern void sceneGraphPrefetch(const char *scene, int depth, SceneWarmFn warm);
+
+// Write the graph in Graphviz dot format
+extern void sceneGraphDump(FILE *out);
+#endif
@@ -0,0 +1,146 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <raylib.h>
+#include "../build/lua/lauxlib.h"
+#include "scriptcache.h"
+
+#define CACHE_MAGIC 0x43424e56 // "VNBC"
+#define CACHE_VERSION 1
+#define REGISTRY_KEY "vn.scripts" // registry table of path to loaded main function
+
+// Written ahead of the lua_dump output, a cache is only used while its source still matches
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int64_t modTime;
+    int64_t size;
+} CacheHeader;
+
+static ScriptCacheStats gStats;
+
+static void cachePath(char *out, size_t size, const char *path) {
+    snprintf(out, size, "%s%s", path, SCRIPT_CACHE_SUFFIX);
+}
+
+static int writeChunk(lua_State *L, const void *data, size_t size, void *ud) {
+    (void)L;
+    return fwrite(data, 1, size, ud) == size ? 0 : 1;
+}
+
+// Dump the function on top of the stack, a read only module folder just means no cache
+static bool writeCache(lua_State *L, const char *path) {
+    char cache[1024];
+    cachePath(cache, sizeof(cache), path);
+    FILE *out = fopen(cache, "wb");
+    if (!out) return false;
+    CacheHeader header = { CACHE_MAGIC, CACHE_VERSION, GetFileModTime(path), GetFileLength(path) };
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1 && lua_dump(L, writeChunk, out, 0) == 0;
+    ok = fclose(out) == 0 && ok;
+    if (!ok) remove(cache);
+    return ok;
+}
+
+// Push the cached main function, LUA_ERRFILE with nothing pushed when there is no usable cache
+static int readCache(lua_State *L, const char *path) {
+    char cache[1024];
+    cachePath(cache, sizeof(cache), path);
+    FILE *in = fopen(cache, "rb");
+    if (!in) return LUA_ERRFILE;
+    CacheHeader header;
+    // Without the source (a precompiled release) the cache is all there is
+    bool ok = fread(&header, sizeof(header), 1, in) == 1 && header.magic == CACHE_MAGIC && header.version == CACHE_VERSION &&
+              (!FileExists(path) || (header.modTime == GetFileModTime(path) && header.size == GetFileLength(path)));
+    char *chunk = NULL;
+    long size = 0;
+    if (ok && fseek(in, 0, SEEK_END) == 0 && (size = ftell(in)) > (long)sizeof(header)) {
+        size -= sizeof(header);
+        chunk = malloc(size);
+        ok = chunk && fseek(in, sizeof(header), SEEK_SET) == 0 && fread(chunk, 1, size, in) == (size_t)size;
+    } else ok = false;
+    fclose(in);
+
+    int status = LUA_ERRFILE;
+    if (ok) {
+        char name[1024];
+        snprintf(name, sizeof(name), "@%s", path);
+        status = luaL_loadbufferx(L, chunk, size, name, "b");
+        if (status != LUA_OK) {
+            // Most likely written by another Lua version, the source is compiled again
+            TraceLog(LOG_WARNING, "Ignoring script cache %s: %s", cache, lua_tostring(L, -1));
+            lua_pop(L, 1);
+            status = LUA_ERRFILE;
+        }
+    }
+    free(chunk);
+    return status;
+}
+
+int scriptCacheLoad(lua_State *L, const char *path) {
+    double start = GetTime();
+    gStats.loads++;
+    if (lua_getfield(L, LUA_REGISTRYINDEX, REGISTRY_KEY) != LUA_TTABLE) {
+        lua_pop(L, 1);
+        lua_newtable(L);
+        lua_pushvalue(L, -1);
+        lua_setfield(L, LUA_REGISTRYINDEX, REGISTRY_KEY);
+    }
+
+    // Main functions hold no state of their own, every call starts a fresh visit of the scene
+    int status = LUA_OK;
+    if (lua_getfield(L, -1, path) == LUA_TFUNCTION) {
+        gStats.memoryHits++;
+    } else {
+        lua_pop(L, 1);
+        status = readCache(L, path);
+        if (status == LUA_OK) {
+            gStats.diskHits++;
+        } else {
+            status = luaL_loadfile(L, path);
+            if (status == LUA_OK) {
+                gStats.compiles++;
+                writeCache(L, path);
+            }
+        }
+        if (status == LUA_OK) {
+            lua_pushvalue(L, -1);
+            lua_setfield(L, -3, path);
+        }
+    }
+    lua_remove(L, -2);
+    gStats.loadTime += GetTime() - start;
+    return status;
+}
+
+bool scriptCacheCompile(lua_State *L, const char *path) {
+    if (luaL_loadfile(L, path) != LUA_OK) {
+        TraceLog(LOG_WARNING, "Error compiling %s: %s", path, lua_tostring(L, -1));
+        lua_pop(L, 1);
+        return false;
+    }
+    bool ok = writeCache(L, path);
+    lua_pop(L, 1);
+    if (!ok) TraceLog(LOG_WARNING, "Could not write script cache for %s", path);
+    return ok;
+}
+
+void scriptCacheDrop(lua_State *L, const char *path) {
+    if (lua_getfield(L, LUA_REGISTRYINDEX, REGISTRY_KEY) == LUA_TTABLE) {
+        lua_pushnil(L);
+        lua_setfield(L, -2, path);
+    }
+    lua_pop(L, 1);
+    char cache[1024];
+    cachePath(cache, sizeof(cache), path);
+    remove(cache);
+}
+
+void scriptCacheClear(lua_State *L) {
+    lua_pushnil(L);
+    lua_setfield(L, LUA_REGISTRYINDEX, REGISTRY_KEY);
+}
+
+ScriptCacheStats scriptCacheGetStats(void) {
+    return gStats;
+}
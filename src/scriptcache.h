@@ -0,0 +1,25 @@
+#ifndef SCRIPTCACHE_H
+#define SCRIPTCACHE_H
+#include <stdbool.h>
+#include "../build/lua/lua.h"
+
+#define SCRIPT_CACHE_SUFFIX ".bc" // compiled chunks are stored next to their source
+
+typedef struct {
+    unsigned long loads;
+    unsigned long memoryHits; // chunk already loaded this session
+    unsigned long diskHits;   // bytecode read from a valid cache file
+    unsigned long compiles;   // source parsed, cache file rewritten
+    double loadTime;          // seconds spent in scriptCacheLoad
+} ScriptCacheStats;
+
+// Push the main function of a script like luaL_loadfile, reusing the chunk loaded earlier or its bytecode on disk
+extern int scriptCacheLoad(lua_State *L, const char *path);
+// Compile a script from source and write its cache file, for precompiling a module
+extern bool scriptCacheCompile(lua_State *L, const char *path);
+// Forget one script's chunk and its cache file after the source was edited
+extern void scriptCacheDrop(lua_State *L, const char *path);
+// Forget loaded chunks, the next load of every script goes back to disk
+extern void scriptCacheClear(lua_State *L);
+extern ScriptCacheStats scriptCacheGetStats(void);
+#endif
@@ -0,0 +1,134 @@
+#include <stdlib.h>
+#include <string.h>
+#include <raylib.h>
+#include "../external/cc.h"
+#include "sfx.h"
+#include "pack.h"
+
+typedef struct {
+    Sound sound;
+    char path[];
+} SfxSource;
+
+// Aliases share the source's samples, each one is a separate playback position
+typedef struct {
+    Sound alias;
+    SfxSource *source;
+    unsigned long started;
+} SfxVoice;
+
+static map(char *, SfxSource *) gSources;
+static bool gSourcesInit = false;
+static SfxVoice gVoices[SFX_VOICES];
+static unsigned long gPlays = 0;
+static float gVolume = 1.0f;
+
+static SfxSource *loadSource(const char *path) {
+    if (!gSourcesInit) {
+        init(&gSources);
+        gSourcesInit = true;
+    }
+    SfxSource **cached = get(&gSources, (char *)path);
+    if (cached) return *cached;
+
+    Sound sound = { 0 };
+    size_t size = 0;
+    const unsigned char *packed = packFind(path, &size);
+    if (packed) {
+        Wave wave = LoadWaveFromMemory(GetFileExtension(path), packed, (int)size);
+        sound = LoadSoundFromWave(wave);
+        UnloadWave(wave);
+    } else {
+        sound = LoadSound(path);
+    }
+    if (sound.frameCount == 0) return NULL;
+    size_t len = strlen(path) + 1;
+    SfxSource *source = malloc(sizeof(SfxSource) + len);
+    if (!source) {
+        UnloadSound(sound);
+        return NULL;
+    }
+    source->sound = sound;
+    memcpy(source->path, path, len);
+    if (!insert(&gSources, source->path, source)) {
+        UnloadSound(sound);
+        free(source);
+        return NULL;
+    }
+    TraceLog(LOG_INFO, "Decoded sound effect: %s", path);
+    return source;
+}
+
+// An idle voice if there is one, otherwise the one that started longest ago
+static SfxVoice *claimVoice(void) {
+    SfxVoice *oldest = &gVoices[0];
+    for (int i = 0; i < SFX_VOICES; i++) {
+        SfxVoice *voice = &gVoices[i];
+        if (!voice->source || !IsSoundPlaying(voice->alias)) return voice;
+        if (voice->started < oldest->started) oldest = voice;
+    }
+    StopSound(oldest->alias);
+    return oldest;
+}
+
+bool sfxPlay(const char *path) {
+    SfxSource *source = loadSource(path);
+    if (!source) return false;
+    SfxVoice *voice = claimVoice();
+    if (voice->source != source) {
+        if (voice->source) UnloadSoundAlias(voice->alias);
+        voice->alias = LoadSoundAlias(source->sound);
+        voice->source = source;
+    }
+    voice->started = ++gPlays;
+    SetSoundVolume(voice->alias, gVolume);
+    PlaySound(voice->alias);
+    return true;
+}
+
+void sfxSetVolume(float volume) {
+    if (volume == gVolume) return;
+    gVolume = volume;
+    for (int i = 0; i < SFX_VOICES; i++)
+        if (gVoices[i].source) SetSoundVolume(gVoices[i].alias, volume);
+}
+
+int sfxVoicesPlaying(void) {
+    int playing = 0;
+    for (int i = 0; i < SFX_VOICES; i++)
+        if (gVoices[i].source && IsSoundPlaying(gVoices[i].alias)) playing++;
+    return playing;
+}
+
+void sfxForget(const char *path) {
+    if (!gSourcesInit) return;
+    SfxSource **cached = get(&gSources, (char *)path);
+    if (!cached) return;
+    SfxSource *source = *cached;
+    for (int i = 0; i < SFX_VOICES; i++) {
+        if (gVoices[i].source != source) continue;
+        StopSound(gVoices[i].alias);
+        UnloadSoundAlias(gVoices[i].alias);
+        memset(&gVoices[i], 0, sizeof(SfxVoice));
+    }
+    erase(&gSources, source->path);
+    UnloadSound(source->sound);
+    free(source);
+}
+
+void sfxClear(void) {
+    // Aliases go first, they point into the sources' buffers
+    for (int i = 0; i < SFX_VOICES; i++) {
+        if (!gVoices[i].source) continue;
+        StopSound(gVoices[i].alias);
+        UnloadSoundAlias(gVoices[i].alias);
+    }
+    memset(gVoices, 0, sizeof(gVoices));
+    if (!gSourcesInit) return;
+    for_each(&gSources, source) {
+        UnloadSound((*source)->sound);
+        free(*source);
+    }
+    cleanup(&gSources);
+    gSourcesInit = false;
+}
@@ -0,0 +1,16 @@
+#ifndef SFX_H
+#define SFX_H
+#include <stdbool.h>
+
+#define SFX_VOICES 16 // effects that can sound at once, the oldest is cut off past this
+
+// Play a sound effect, the file is decoded once and then shared by every voice playing it
+extern bool sfxPlay(const char *path);
+// Applies to voices that are already playing as well as later ones
+extern void sfxSetVolume(float volume);
+extern int sfxVoicesPlaying(void);
+// Stop and unload one effect, it is decoded again the next time it plays
+extern void sfxForget(const char *path);
+// Stop every voice and unload every decoded effect
+extern void sfxClear(void);
+#endif
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "texcache.h"
+
+#define TEX_CACHE_MAGIC 0x58544e56 // "VNTX"
+#define TEX_CACHE_VERSION 2
+#define TEX_CACHE_PATH_SIZE 1024
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t variant;
+    int32_t format;
+    int32_t width;
+    int32_t height;
+    int32_t sourceWidth;  // before any resampling, layout is in these
+    int32_t sourceHeight;
+    TexCacheKey source;
+    uint64_t dataSize;
+} TexCacheHeader;
+
+static pthread_mutex_t gStatsLock = PTHREAD_MUTEX_INITIALIZER;
+static TexCacheStats gStats = { 0 };
+static bool gWritable = true;
+static atomic_ulong gTempSerial = 0; // every write gets its own temporary file, two workers may store the same image
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Eight bytes a step, a pack entry is hashed in well under the time a decode takes
+static uint64_t hashBytes(const unsigned char *data, size_t size) {
+    uint64_t hash = 0x9e3779b97f4a7c15ull ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+        hash ^= hash >> 32;
+    }
+    for (; i < size; i++)
+        hash = (hash ^ data[i]) * 0x100000001b3ull;
+    return hash;
+}
+
+TexCacheKey texCacheKey(const char *path, const unsigned char *packed, size_t packedSize) {
+    if (packed) return (TexCacheKey){ (int64_t)packedSize, 0, hashBytes(packed, packedSize) };
+    return (TexCacheKey){ GetFileLength(path), GetFileModTime(path), 0 };
+}
+
+static void cachePath(char *out, size_t size, const char *path) {
+    snprintf(out, size, "%s%s", path, TEX_CACHE_SUFFIX);
+}
+
+static void countLookup(bool hit, double seconds) {
+    pthread_mutex_lock(&gStatsLock);
+    if (hit) {
+        gStats.hits++;
+        gStats.readTime += seconds;
+    } else {
+        gStats.misses++;
+    }
+    pthread_mutex_unlock(&gStatsLock);
+}
+
+Image texCacheLoad(const char *path, uint32_t variant, TexCacheKey source, int *sourceWidth, int *sourceHeight) {
+    double start = now();
+    char cache[TEX_CACHE_PATH_SIZE];
+    cachePath(cache, sizeof(cache), path);
+    FILE *in = fopen(cache, "rb");
+    if (!in) {
+        countLookup(false, 0);
+        return (Image){ 0 };
+    }
+    TexCacheHeader header;
+    bool ok = fread(&header, sizeof(header), 1, in) == 1 && header.magic == TEX_CACHE_MAGIC &&
+              header.version == TEX_CACHE_VERSION && header.variant == variant && header.width > 0 && header.height > 0 &&
+              header.sourceWidth >= header.width && header.sourceHeight >= header.height &&
+              memcmp(&header.source, &source, sizeof(source)) == 0 &&
+              header.dataSize == (uint64_t)GetPixelDataSize(header.width, header.height, header.format);
+    void *data = ok ? malloc(header.dataSize) : NULL;
+    // Straight into the buffer the upload reads from
+    ok = data && fread(data, 1, header.dataSize, in) == header.dataSize;
+    fclose(in);
+    if (!ok) {
+        free(data);
+        countLookup(false, 0);
+        return (Image){ 0 };
+    }
+    countLookup(true, now() - start);
+    *sourceWidth = header.sourceWidth;
+    *sourceHeight = header.sourceHeight;
+    return (Image){ data, header.width, header.height, 1, header.format };
+}
+
+void texCacheStore(const char *path, uint32_t variant, TexCacheKey source, Image image, int sourceWidth,
+                   int sourceHeight) {
+    if (!gWritable || !image.data || image.mipmaps > 1) return;
+    char cache[TEX_CACHE_PATH_SIZE], temp[TEX_CACHE_PATH_SIZE + 32];
+    cachePath(cache, sizeof(cache), path);
+    // Still ends in .tmp, the watcher skips it
+    snprintf(temp, sizeof(temp), "%s.%lu.tmp", cache, atomic_fetch_add(&gTempSerial, 1));
+    FILE *out = fopen(temp, "wb");
+    // A module shipped as a pack may have no folder to write into, it then decodes every time
+    if (!out) return;
+    TexCacheHeader header = { TEX_CACHE_MAGIC, TEX_CACHE_VERSION, variant, image.format, image.width, image.height,
+                              sourceWidth, sourceHeight, source, (uint64_t)GetPixelDataSize(image.width, image.height, image.format) };
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1 && fwrite(image.data, 1, header.dataSize, out) == header.dataSize;
+    ok = fclose(out) == 0 && ok;
+    // Renamed into place so another worker never reads half a file
+    if (!ok || rename(temp, cache) != 0) {
+        remove(temp);
+        return;
+    }
+    pthread_mutex_lock(&gStatsLock);
+    gStats.writes++;
+    pthread_mutex_unlock(&gStatsLock);
+}
+
+void texCacheDrop(const char *path) {
+    char cache[TEX_CACHE_PATH_SIZE];
+    cachePath(cache, sizeof(cache), path);
+    remove(cache);
+}
+
+void texCacheSetWritable(bool writable) {
+    gWritable = writable;
+}
+
+TexCacheStats texCacheGetStats(void) {
+    pthread_mutex_lock(&gStatsLock);
+    TexCacheStats stats = gStats;
+    pthread_mutex_unlock(&gStatsLock);
+    return stats;
+}
@@ -0,0 +1,38 @@
+#ifndef TEXCACHE_H
+#define TEXCACHE_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <raylib.h>
+
+#define TEX_CACHE_SUFFIX ".tex" // decoded pixels are stored next to the source image
+
+// What the cached pixels were made from, a loose file is matched by size and time, a packed one by its bytes
+typedef struct {
+    int64_t size;
+    int64_t modTime;
+    uint64_t hash;
+} TexCacheKey;
+
+typedef struct {
+    unsigned long hits;
+    unsigned long misses;  // no cache file, or it no longer matches its source
+    unsigned long writes;
+    double readTime;       // seconds spent reading cached pixels
+} TexCacheStats;
+
+// Taken before the source is read, an edit made while it decodes then leaves the stored pixels unmatched
+// packed holds the source file when it comes from a module pack, NULL for a loose file
+extern TexCacheKey texCacheKey(const char *path, const unsigned char *packed, size_t packedSize);
+// The pixels stored for an image after the steps variant stands for, data is NULL on a miss
+// sourceWidth and sourceHeight get the decoded size before any resampling
+extern Image texCacheLoad(const char *path, uint32_t variant, TexCacheKey source, int *sourceWidth, int *sourceHeight);
+// Keep a decoded image for the next texCacheLoad of the same source and variant, called from the decoding thread
+extern void texCacheStore(const char *path, uint32_t variant, TexCacheKey source, Image image, int sourceWidth,
+                          int sourceHeight);
+// Delete the cache file of an image that was just edited, its size and time may not have changed enough to tell
+extern void texCacheDrop(const char *path);
+// Whether misses write cache files, reading is always on
+extern void texCacheSetWritable(bool writable);
+extern TexCacheStats texCacheGetStats(void);
+#endif
@@ -0,0 +1,288 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <raylib.h>
+#include <rlgl.h>
+#include "textlayout.h"
+
+#define GLYPH_PAGE_BITS 8
+#define GLYPH_PAGE_SIZE (1 << GLYPH_PAGE_BITS)
+#define GLYPH_PAGES (0x10000 / GLYPH_PAGE_SIZE) // basic multilingual plane, anything above goes through GetGlyphIndex
+
+typedef struct {
+    float x, y, width, height; // relative to the box origin
+    float u0, v0, u1, v1;
+} TextQuad;
+
+struct TextLayout {
+    uint64_t hash;
+    char *text;         // NULL while the slot is unused
+    Texture2D texture;
+    const GlyphInfo *glyphs;
+    float fontSize;
+    float spacing;
+    float width;
+    float height;
+    bool wordWrap;
+    unsigned long lastUse;
+    TextQuad *quads;
+    int count;
+    int capacity;
+};
+
+// Codepoint to glyph index, pages without any glyph resolve to the fallback like GetGlyphIndex does
+typedef struct {
+    unsigned int texture; // 0 while the slot is unused
+    const GlyphInfo *glyphs;
+    int glyphCount;
+    int fallback;
+    bool partial;         // a page failed to allocate, missing pages have to be searched
+    int *pages[GLYPH_PAGES];
+    unsigned long lastUse;
+} GlyphTable;
+
+static TextLayout gLayouts[TEXT_LAYOUT_CACHE];
+static GlyphTable gTables[TEXT_LAYOUT_FONTS];
+static unsigned long gClock = 0;
+static TextLayoutStats gStats;
+
+static uint64_t hashText(const char *text) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const unsigned char *c = (const unsigned char *)text; *c; c++) {
+        hash ^= *c;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static void freeTable(GlyphTable *table) {
+    for (int i = 0; i < GLYPH_PAGES; i++)
+        free(table->pages[i]);
+    memset(table, 0, sizeof(GlyphTable));
+}
+
+static GlyphTable *glyphTable(Font font) {
+    GlyphTable *slot = &gTables[0];
+    for (int i = 0; i < TEXT_LAYOUT_FONTS; i++) {
+        GlyphTable *table = &gTables[i];
+        if (table->texture == font.texture.id && table->glyphs == font.glyphs && table->glyphCount == font.glyphCount) {
+            table->lastUse = ++gClock;
+            return table;
+        }
+        if (table->lastUse < slot->lastUse) slot = table;
+    }
+    freeTable(slot);
+    slot->texture = font.texture.id;
+    slot->glyphs = font.glyphs;
+    slot->glyphCount = font.glyphCount;
+    slot->lastUse = ++gClock;
+    for (int i = 0; i < font.glyphCount; i++)
+        if (font.glyphs[i].value == '?') slot->fallback = i;
+    // Backwards so the first glyph of a codepoint wins, as with the linear search
+    for (int i = font.glyphCount - 1; i >= 0; i--) {
+        int codepoint = font.glyphs[i].value;
+        if (codepoint < 0 || codepoint >= 0x10000) continue;
+        int **page = &slot->pages[codepoint >> GLYPH_PAGE_BITS];
+        if (!*page) {
+            *page = malloc(GLYPH_PAGE_SIZE * sizeof(int));
+            if (!*page) {
+                slot->partial = true;
+                continue;
+            }
+            for (int j = 0; j < GLYPH_PAGE_SIZE; j++) (*page)[j] = slot->fallback;
+        }
+        (*page)[codepoint & (GLYPH_PAGE_SIZE - 1)] = i;
+    }
+    return slot;
+}
+
+static inline int glyphIndex(const GlyphTable *table, Font font, int codepoint) {
+    if (codepoint < 0 || codepoint >= 0x10000) return GetGlyphIndex(font, codepoint);
+    const int *page = table->pages[codepoint >> GLYPH_PAGE_BITS];
+    if (page) return page[codepoint & (GLYPH_PAGE_SIZE - 1)];
+    return table->partial ? GetGlyphIndex(font, codepoint) : table->fallback;
+}
+
+// Same quad DrawTextCodepoint would draw for the glyph at pos
+static void pushQuad(TextLayout *layout, Font font, int index, Vector2 pos, float scaleFactor) {
+    if (layout->count == layout->capacity) return;
+    Rectangle rec = font.recs[index];
+    float padding = (float)font.glyphPadding;
+    TextQuad *quad = &layout->quads[layout->count++];
+    quad->x = pos.x + (font.glyphs[index].offsetX - padding)*scaleFactor;
+    quad->y = pos.y + (font.glyphs[index].offsetY - padding)*scaleFactor;
+    quad->width = (rec.width + 2.0f*padding)*scaleFactor;
+    quad->height = (rec.height + 2.0f*padding)*scaleFactor;
+    quad->u0 = (rec.x - padding)/font.texture.width;
+    quad->v0 = (rec.y - padding)/font.texture.height;
+    quad->u1 = (rec.x + rec.width + padding)/font.texture.width;
+    quad->v1 = (rec.y + rec.height + padding)/font.texture.height;
+}
+
+// The measure and draw state machine of DrawTextBoxed (boundedtext.c), recording quads instead of drawing
+static void layoutText(TextLayout *layout, Font font, const GlyphTable *table, const char *text) {
+    int length = (int)TextLength(text);
+    float textOffsetY = 0;
+    float textOffsetX = 0.0f;
+    float scaleFactor = layout->fontSize/(float)font.baseSize;
+    float lineHeight = ((float)font.baseSize + ((float)font.baseSize)/2)*scaleFactor;
+
+    enum { MEASURE_STATE = 0, DRAW_STATE = 1 };
+    int state = layout->wordWrap? MEASURE_STATE : DRAW_STATE;
+    int startLine = -1;
+    int endLine = -1;
+
+    for (int i = 0; i < length; i++) {
+        int codepointByteCount = 0;
+        int codepoint = GetCodepoint(&text[i], &codepointByteCount);
+        int index = glyphIndex(table, font, codepoint);
+
+        // Bad bytes are drawn as '?' one byte at a time
+        if (codepoint == 0x3f) codepointByteCount = 1;
+        i += (codepointByteCount - 1);
+
+        float glyphWidth = 0;
+        if (codepoint != '\n') {
+            glyphWidth = (font.glyphs[index].advanceX == 0) ? font.recs[index].width*scaleFactor : (float)font.glyphs[index].advanceX*scaleFactor;
+            if (i + 1 < length) glyphWidth = glyphWidth + layout->spacing;
+        }
+
+        if (state == MEASURE_STATE) {
+            if ((codepoint == ' ') || (codepoint == '\t') || (codepoint == '\n')) endLine = i;
+
+            if ((textOffsetX + glyphWidth) > layout->width) {
+                endLine = (endLine < 1)? i : endLine;
+                if (i == endLine) endLine -= codepointByteCount;
+                if ((startLine + codepointByteCount) == endLine) endLine = (i - codepointByteCount);
+                state = !state;
+            } else if ((i + 1) == length) {
+                endLine = i;
+                state = !state;
+            } else if (codepoint == '\n') state = !state;
+
+            if (state == DRAW_STATE) {
+                textOffsetX = 0;
+                i = startLine;
+                glyphWidth = 0;
+            }
+        } else {
+            if (codepoint == '\n') {
+                if (!layout->wordWrap) {
+                    textOffsetY += lineHeight;
+                    textOffsetX = 0;
+                }
+            } else {
+                if (!layout->wordWrap && ((textOffsetX + glyphWidth) > layout->width)) {
+                    textOffsetY += lineHeight;
+                    textOffsetX = 0;
+                }
+                if ((textOffsetY + ((float)font.baseSize)*scaleFactor) > layout->height) break;
+                if ((codepoint != ' ') && (codepoint != '\t'))
+                    pushQuad(layout, font, index, (Vector2){ textOffsetX, textOffsetY }, scaleFactor);
+            }
+
+            if (layout->wordWrap && (i == endLine)) {
+                textOffsetY += lineHeight;
+                textOffsetX = 0;
+                startLine = endLine;
+                endLine = -1;
+                glyphWidth = 0;
+                state = !state;
+            }
+        }
+
+        if ((textOffsetX != 0) || (codepoint != ' ')) textOffsetX += glyphWidth;
+    }
+}
+
+static void freeLayout(TextLayout *layout) {
+    free(layout->text);
+    free(layout->quads);
+    memset(layout, 0, sizeof(TextLayout));
+}
+
+static bool sameKey(const TextLayout *layout, uint64_t hash, Font font, const char *text, Rectangle rec, float fontSize, float spacing, bool wordWrap) {
+    return layout->text && layout->hash == hash && layout->texture.id == font.texture.id && layout->glyphs == font.glyphs &&
+           layout->fontSize == fontSize && layout->spacing == spacing && layout->wordWrap == wordWrap &&
+           layout->width == rec.width && layout->height == rec.height && strcmp(layout->text, text) == 0;
+}
+
+const TextLayout *textLayoutGet(Font font, const char *text, Rectangle rec, float fontSize, float spacing, bool wordWrap) {
+    uint64_t hash = hashText(text);
+    TextLayout *slot = &gLayouts[0];
+    for (int i = 0; i < TEXT_LAYOUT_CACHE; i++) {
+        TextLayout *layout = &gLayouts[i];
+        if (sameKey(layout, hash, font, text, rec, fontSize, spacing, wordWrap)) {
+            layout->lastUse = ++gClock;
+            gStats.hits++;
+            return layout;
+        }
+        if (layout->lastUse < slot->lastUse) slot = layout;
+    }
+
+    freeLayout(slot);
+    size_t len = strlen(text) + 1;
+    slot->text = malloc(len);
+    // Every glyph takes at least one byte of text
+    slot->capacity = len - 1 ? (int)len - 1 : 1;
+    slot->quads = malloc(slot->capacity * sizeof(TextQuad));
+    if (!slot->text || !slot->quads) {
+        freeLayout(slot);
+        return NULL;
+    }
+    memcpy(slot->text, text, len);
+    slot->hash = hash;
+    slot->texture = font.texture;
+    slot->glyphs = font.glyphs;
+    slot->fontSize = fontSize;
+    slot->spacing = spacing;
+    slot->wordWrap = wordWrap;
+    slot->width = rec.width;
+    slot->height = rec.height;
+    slot->lastUse = ++gClock;
+    layoutText(slot, font, glyphTable(font), text);
+    gStats.builds++;
+    return slot;
+}
+
+int textLayoutGlyphs(const TextLayout *layout) {
+    return layout ? layout->count : 0;
+}
+
+void textLayoutDraw(const TextLayout *layout, Vector2 origin, int reveal, Color tint) {
+    if (!layout) return;
+    int count = (reveal < 0 || reveal > layout->count) ? layout->count : reveal;
+    if (count == 0) return;
+
+    // Every glyph shares the font texture, so the whole string goes into the batch as one run of quads
+    rlCheckRenderBatchLimit(4*count);
+    rlSetTexture(layout->texture.id);
+    rlBegin(RL_QUADS);
+    rlColor4ub(tint.r, tint.g, tint.b, tint.a);
+    rlNormal3f(0.0f, 0.0f, 1.0f);
+    for (int i = 0; i < count; i++) {
+        const TextQuad *quad = &layout->quads[i];
+        float x = origin.x + quad->x, y = origin.y + quad->y;
+        rlTexCoord2f(quad->u0, quad->v0);
+        rlVertex2f(x, y);
+        rlTexCoord2f(quad->u0, quad->v1);
+        rlVertex2f(x, y + quad->height);
+        rlTexCoord2f(quad->u1, quad->v1);
+        rlVertex2f(x + quad->width, y + quad->height);
+        rlTexCoord2f(quad->u1, quad->v0);
+        rlVertex2f(x + quad->width, y);
+    }
+    rlEnd();
+    rlSetTexture(0);
+}
+
+void textLayoutClear(void) {
+    for (int i = 0; i < TEXT_LAYOUT_CACHE; i++)
+        freeLayout(&gLayouts[i]);
+    for (int i = 0; i < TEXT_LAYOUT_FONTS; i++)
+        freeTable(&gTables[i]);
+}
+
+TextLayoutStats textLayoutGetStats(void) {
+    return gStats;
+}
@@ -0,0 +1,26 @@
+#ifndef TEXTLAYOUT_H
+#define TEXTLAYOUT_H
+#include <stdbool.h>
+#include <raylib.h>
+
+#define TEXT_LAYOUT_CACHE 8  // layouts kept, least recently drawn is replaced first
+#define TEXT_LAYOUT_FONTS 4  // fonts with a codepoint table
+
+// Line breaks and glyph quads of a string wrapped inside a box, positioned relative to the box origin
+typedef struct TextLayout TextLayout;
+
+typedef struct {
+    unsigned long hits;
+    unsigned long builds;
+} TextLayoutStats;
+
+// Lay text out the way DrawTextBoxed would, reusing a cached layout for the same text, font, size and box size
+extern const TextLayout *textLayoutGet(Font font, const char *text, Rectangle rec, float fontSize, float spacing, bool wordWrap);
+// Glyphs that would be drawn, the upper bound for a reveal count
+extern int textLayoutGlyphs(const TextLayout *layout);
+// Draw the first reveal glyphs at the box origin in one batch, a negative count draws all of them
+extern void textLayoutDraw(const TextLayout *layout, Vector2 origin, int reveal, Color tint);
+// Drop cached layouts and codepoint tables, needed before a font they point at is unloaded
+extern void textLayoutClear(void);
+extern TextLayoutStats textLayoutGetStats(void);
+#endif
@@ -0,0 +1,206 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <raylib.h>
+#ifdef __linux__
+#include <dirent.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#endif
+#include "../external/cc.h"
+#include "watcher.h"
+#include "glyphatlas.h"
+#include "pack.h"
+#include "texcache.h"
+
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static vec(char *) gReady;   // changes of finished batches, guarded by gLock
+static atomic_bool gHasReady;
+static WatchWakeFn gWakeLoop = NULL;
+
+#ifdef __linux__
+typedef struct {
+    int wd;
+    char *path;
+} WatchDir;
+
+static pthread_t gThread;
+static bool gRunning = false;
+static int gNotify = -1;
+static int gWake[2] = { -1, -1 }; // written to by watcherStop
+static vec(WatchDir) gDirs;       // owned by the watcher thread while it runs
+
+static bool ignored(const char *name) {
+    size_t length = strlen(name);
+    // Editor swap and backup files
+    if (length == 0 || name[0] == '.' || name[length - 1] == '~') return true;
+    if (strcmp(name, PACK_FILE) == 0) return true;
+    const char *extension = strrchr(name, '.');
+    if (!extension) return false;
+    return strcmp(extension, ".bc") == 0 || strcmp(extension, TEX_CACHE_SUFFIX) == 0 ||
+           strcmp(extension, GLYPH_ATLAS_CACHE_SUFFIX) == 0 || strcmp(extension, ".tmp") == 0 ||
+           strcmp(extension, ".swp") == 0;
+}
+
+// inotify is not recursive, every directory gets a watch of its own
+static void watchTree(const char *path) {
+    int wd = inotify_add_watch(gNotify, path, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR);
+    if (wd < 0) {
+        TraceLog(LOG_WARNING, "Could not watch %s", path);
+        return;
+    }
+    push(&gDirs, ((WatchDir){ wd, strdup(path) }));
+    DIR *dir = opendir(path);
+    if (!dir) return;
+    struct dirent *entry;
+    while ((entry = readdir(dir))) {
+        if (entry->d_name[0] == '.') continue;
+        char child[WATCH_PATH_SIZE];
+        struct stat st;
+        snprintf(child, WATCH_PATH_SIZE, "%s/%s", path, entry->d_name);
+        if (stat(child, &st) == 0 && S_ISDIR(st.st_mode)) watchTree(child);
+    }
+    closedir(dir);
+}
+
+static const char *watchedDir(int wd) {
+    for_each(&gDirs, dir)
+        if (dir->wd == wd) return dir->path;
+    return NULL;
+}
+
+static void addChange(vec(char *) *changes, const char *path) {
+    for_each(changes, it)
+        if (strcmp(*it, path) == 0) return;
+    push(changes, strdup(path));
+}
+
+// A save is often several events (truncate, write, rename), the batch goes out once they stop
+static void publish(vec(char *) *pending) {
+    pthread_mutex_lock(&gLock);
+    for_each(pending, path) {
+        addChange(&gReady, *path);
+        free(*path);
+    }
+    atomic_store_explicit(&gHasReady, true, memory_order_release);
+    pthread_mutex_unlock(&gLock);
+    clear(pending);
+    if (gWakeLoop) gWakeLoop();
+}
+
+static void *watchThread(void *arg) {
+    (void)arg;
+    vec(char *) pending;
+    init(&pending);
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct pollfd fds[2] = { { gNotify, POLLIN, 0 }, { gWake[0], POLLIN, 0 } };
+    for (;;) {
+        int ready = poll(fds, 2, size(&pending) > 0 ? WATCH_DEBOUNCE_MS : -1);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready < 0 || fds[1].revents) break;
+        if (ready == 0) {
+            publish(&pending);
+            continue;
+        }
+        ssize_t length = read(gNotify, buffer, sizeof(buffer));
+        for (char *p = buffer; length > 0 && p < buffer + length;) {
+            const struct inotify_event *event = (const struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + event->len;
+            const char *dir = watchedDir(event->wd);
+            if (!dir || event->len == 0) continue;
+            char path[WATCH_PATH_SIZE];
+            snprintf(path, WATCH_PATH_SIZE, "%s/%s", dir, event->name);
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) watchTree(path);
+            } else if (!(event->mask & IN_CREATE) && !ignored(event->name)) {
+                // A created file is reported again when it is closed
+                addChange(&pending, path);
+            }
+        }
+    }
+    for_each(&pending, path) free(*path);
+    cleanup(&pending);
+    return NULL;
+}
+
+bool watcherStart(const char *folder, WatchWakeFn wake) {
+    watcherStop();
+    gWakeLoop = wake;
+    gNotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (gNotify < 0 || pipe(gWake) != 0) {
+        TraceLog(LOG_WARNING, "Could not start watching %s", folder);
+        watcherStop();
+        return false;
+    }
+    init(&gDirs);
+    init(&gReady);
+    watchTree(folder);
+    if (pthread_create(&gThread, NULL, watchThread, NULL) != 0) {
+        TraceLog(LOG_WARNING, "Could not start the file watcher thread");
+        for_each(&gDirs, dir) free(dir->path);
+        cleanup(&gDirs);
+        cleanup(&gReady);
+        watcherStop();
+        return false;
+    }
+    gRunning = true;
+    TraceLog(LOG_INFO, "Watching %s: %zu directories", folder, size(&gDirs));
+    return true;
+}
+
+void watcherStop(void) {
+    if (gRunning) {
+        ssize_t written = write(gWake[1], "", 1);
+        (void)written;
+        pthread_join(gThread, NULL);
+        gRunning = false;
+        for_each(&gDirs, dir) free(dir->path);
+        cleanup(&gDirs);
+        pthread_mutex_lock(&gLock);
+        for_each(&gReady, path) free(*path);
+        cleanup(&gReady);
+        atomic_store(&gHasReady, false);
+        pthread_mutex_unlock(&gLock);
+    }
+    if (gNotify >= 0) close(gNotify);
+    if (gWake[0] >= 0) close(gWake[0]);
+    if (gWake[1] >= 0) close(gWake[1]);
+    gNotify = gWake[0] = gWake[1] = -1;
+}
+#else
+bool watcherStart(const char *folder, WatchWakeFn wake) {
+    (void)wake;
+    TraceLog(LOG_WARNING, "Hot reload needs inotify, not watching %s", folder);
+    return false;
+}
+
+void watcherStop(void) {
+}
+#endif
+
+int watcherPoll(WatchChangeFn changed) {
+    if (!atomic_load_explicit(&gHasReady, memory_order_acquire)) return 0;
+    pthread_mutex_lock(&gLock);
+    size_t count = size(&gReady);
+    char **paths = malloc(count * sizeof(char *));
+    if (paths) {
+        for (size_t i = 0; i < count; i++)
+            paths[i] = *get(&gReady, i);
+        clear(&gReady);
+        atomic_store_explicit(&gHasReady, false, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&gLock);
+    if (!paths) return 0;
+    // Called without the lock, a reload may take a while
+    for (size_t i = 0; i < count; i++) {
+        changed(paths[i]);
+        free(paths[i]);
+    }
+    free(paths);
+    return (int)count;
+}
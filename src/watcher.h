@@ -0,0 +1,19 @@
+#ifndef WATCHER_H
+#define WATCHER_H
+#include <stdbool.h>
+
+#define WATCH_DEBOUNCE_MS 150 // quiet time after the last event before a batch of changes is handed over
+#define WATCH_PATH_SIZE 1024
+
+// Called on the main thread with the path of a file that was written, moved in or created, once per batch
+typedef void (*WatchChangeFn)(const char *path);
+// Called on the watcher thread once a batch is ready, so a main loop asleep waiting for input gets to poll it
+typedef void (*WatchWakeFn)(void);
+
+// Watch every file under folder from a thread of its own, replaces an earlier watch, false where inotify is missing
+// Caches the engine writes beside their sources and editor swap files are ignored
+extern bool watcherStart(const char *folder, WatchWakeFn wake);
+extern void watcherStop(void);
+// Hand over the changes of every finished batch, a single atomic load when there are none
+extern int watcherPoll(WatchChangeFn changed);
+#endif